@@ -0,0 +1,7 @@
+#!/bin/sh
+# Headless render benchmark, results are written as JSON.
+# usage: bench.sh [frames per VU meter] [results file] [extra sqvumeter options]
+FRAMES=${1:-600}
+RESULTS=${2:-bench.json}
+shift 2 2>/dev/null
+./bin/sqvumeter dl ./lib/TubeD.so  dl ./lib/Chevrons.so dl ./lib/PurpleTastic.so dl ./lib/Speaker25.so json ./npvu.json bench $FRAMES bench_json $RESULTS $*
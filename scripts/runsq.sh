@@ -49,9 +49,10 @@ fi
 if [ -f "/usr/local/etc/pcp/pcpversion.cfg" ]; then
     echo "Platform is piCorePlayer, setting up touch screen"
     pcp_setup
-    export TCACHE_SIZE="texture_cache_size 59768832"
 fi
-export TCACHE_SIZE="texture_cache_size 50000000"
+# texture cache limit is tuned at runtime,
+# set TCACHE_SIZE="texture_cache_size <bytes>" in the environment to use a fixed limit.
+export TCACHE_SIZE=${TCACHE_SIZE:-"texture_cache_size auto"}
 
 #./bin/sqvumeter dl ./lib/TubeD.so  dl ./lib/Chevrons.so dl ./lib/PurpleTastic.so vsync vu PurpleTastic2Transparent $* $TCACHE_SIZE
 ./bin/sqvumeter dl ./lib/TubeD.so  dl ./lib/Chevrons.so dl ./lib/PurpleTastic.so dl ./lib/Speaker25.so vu PurpleTastic2Transparent $* $TCACHE_SIZE
@@ -3,7 +3,6 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <SDL2/SDL_syswm.h>
 #include <SDL2/SDL_render.h>
 #include <SDL2/SDL_blendmode.h>
 
@@ -17,10 +16,23 @@
 #include "lyrion_player.h"
 #include "widgets_json.h"
 #include "vumeter_util.h"
+#include "frame_pacer.h"
+#include "frame_governor.h"
+#include "frame_timeline.h"
+#include "quality_governor.h"
+#include "draw_stats.h"
+#include "render_select.h"
+#include "refresh_estimator.h"
 
 #define HIDE_CURSOR_COUNT  50
 #define IMAGE_FLAGS IMG_INIT_PNG
 #define FPS_SAMPLE_COUNT 60
+// frames between frame pacer reports
+#define PACER_REPORT_FRAMES (FPS_SAMPLE_COUNT * 10)
+// time allowed for SDL_RenderPresent before the frame deadline
+#define PRESENT_LEAD_MICROS 1000
+// upper bound of texture memory allocated by the startup probe
+#define TEXTURE_PROBE_MAX_BYTES (256*1024*1024)
 
 static SDL_RendererFlags render_flags = SDL_RENDERER_ACCELERATED;
 static int show_cursor = 0;
@@ -39,10 +51,28 @@ static inline void free_ex(void** tgt) {
 }
 #define FREE(x) free_ex((void **)(&x))
 
+// Player discovery may block, it runs while the display is set up
+// and the media loaded, the player thread waits for it.
+static int discover_player(void* data) {
+    app_context* app_ctx = data;
+    player_ptr player = open_local_player(app_ctx->lms);
+    __atomic_store_n(&app_ctx->player, player, __ATOMIC_RELEASE);
+    printf("startup: player opened after %ld milliseconds\n", (get_micro_seconds() - app_ctx->start_usecs)/1000);
+    tcache_thread_exit();
+    return 0;
+}
+
 bool app_initialize(app_context* app_ctx, const char* window_title) {
     app_ctx->workspace.player_mode = PLAYER_MODE_UNDEFINED;
 
-    app_ctx->player = open_local_player(app_ctx->lms);
+    if (app_ctx->bench_frames == 0) {
+        SDL_Thread* thread = SDL_CreateThread(discover_player, "discover", app_ctx);
+        if (thread) {
+            SDL_DetachThread(thread);
+        } else {
+            discover_player(app_ctx);
+        }
+    }
     app_ctx->default_font_path = "fonts/FreeSans.ttf";
 
     if (app_ctx->vsync) {
@@ -71,6 +101,10 @@ bool app_initialize(app_context* app_ctx, const char* window_title) {
             if (0 == SDL_GetCurrentDisplayMode(i_display, &dm)) {
                 // TODO: handle multiple displays?
                 if (i_display == 0) {
+                    if (dm.refresh_rate <= 0) {
+                        // not reported, e.g. by the dummy video driver
+                        dm.refresh_rate = 60;
+                    }
                     app_ctx->refresh_rate = dm.refresh_rate;
                     app_ctx->frame_time_millis = 1000/dm.refresh_rate;
                     app_ctx->frame_time_micros = 1000000/dm.refresh_rate;
@@ -84,83 +118,32 @@ bool app_initialize(app_context* app_ctx, const char* window_title) {
             } 
     }
 
-    SDL_Window *window;
-
-    sleep(1);
-    window =  SDL_CreateWindow(window_title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 0, 0, SDL_WINDOW_FULLSCREEN_DESKTOP);
-
-    SDL_SysWMinfo swmi;
-    if (SDL_GetWindowWMInfo(window, &swmi)) {
-        SDL_DestroyWindow(window);
-        switch(swmi.subsystem) {
-           case SDL_SYSWM_UNKNOWN:
-               // puts("SDL_SYSWM_UNKNOWN");
-               break;
-           case SDL_SYSWM_WINDOWS:
-               // puts("SDL_SYSWM_WINDOWS");
-               break;
-           case SDL_SYSWM_X11:
-               // puts("SDL_SYSWM_X11");
-               break;
-           case SDL_SYSWM_DIRECTFB:
-               // puts("SDL_SYSWM_DIRECTFB");
-               break;
-           case SDL_SYSWM_COCOA:
-               // puts("SDL_SYSWM_COCOA");
-               break;
-           case SDL_SYSWM_UIKIT:
-               // puts("SDL_SYSWM_UIKIT");
-               break;
-           case SDL_SYSWM_WAYLAND:
-/*               
-               if (orientation == 90.0 || orientation ==270) {
-                   int tmp = screen_width;
-                   screen_width = screen_height;
-                   screen_height = tmp;
-               }
-*/
-                // puts("SDL_SYSWM_WAYLAND");
-                if (app_ctx->fullscreen) {
-                    app_ctx->window = SDL_CreateWindow(window_title,
-                           SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                           0, 0,
-                           SDL_WINDOW_FULLSCREEN_DESKTOP);
-                } else {
-                    app_ctx->window = SDL_CreateWindow(window_title,
-                            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                            app_ctx->screen_width, app_ctx->screen_height,
-                            0);
-                }
-               break;
-           case SDL_SYSWM_MIR:
-               // puts("SDL_SYSWM_MIR");
-               break;
-           case SDL_SYSWM_WINRT:
-               // puts("SDL_SYSWM_WINRT");
-               break;
-           case SDL_SYSWM_ANDROID:
-               // puts("SDL_SYSWM_ANDROID");
-               break;
-           case SDL_SYSWM_VIVANTE:
-               // puts("SDL_SYSWM_VIVANTE");
-               break;
-           case SDL_SYSWM_OS2:
-               // puts("SDL_SYSWM_OS2");
-               break;
-           case SDL_SYSWM_HAIKU:
-               // puts("SDL_SYSWM_HAIKU");
-               break;
-           case SDL_SYSWM_KMSDRM:
-                puts("SDL_SYSWM_KMSDRM");
-                app_ctx->window = SDL_CreateWindow(window_title,
-                       SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                       0, 0,
-                       SDL_WINDOW_FULLSCREEN_DESKTOP);
-               break;
-           case SDL_SYSWM_RISCOS:
-               // puts("SDL_SYSWM_RISCOS");
-               break;
+    // The window depends on the video driver, the name is known without
+    // creating and destroying a probe window.
+    const char* video_driver = SDL_GetCurrentVideoDriver();
+    if (app_ctx->bench_frames) {
+        app_ctx->window = SDL_CreateWindow(window_title,
+                SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                app_ctx->screen_width, app_ctx->screen_height,
+                0);
+    } else if (video_driver && 0 == SDL_strcasecmp(video_driver, "wayland")) {
+        if (app_ctx->fullscreen) {
+            app_ctx->window = SDL_CreateWindow(window_title,
+                   SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                   0, 0,
+                   SDL_WINDOW_FULLSCREEN_DESKTOP);
+        } else {
+            app_ctx->window = SDL_CreateWindow(window_title,
+                    SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                    app_ctx->screen_width, app_ctx->screen_height,
+                    0);
         }
+    } else if (video_driver && 0 == SDL_strcasecmp(video_driver, "KMSDRM")) {
+        puts("SDL_SYSWM_KMSDRM");
+        app_ctx->window = SDL_CreateWindow(window_title,
+               SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+               0, 0,
+               SDL_WINDOW_FULLSCREEN_DESKTOP);
     }
 
     if (!app_ctx->window) {
@@ -168,13 +151,49 @@ bool app_initialize(app_context* app_ctx, const char* window_title) {
         return true;
     }
 //    app_ctx->renderer = SDL_CreateRenderer(app_ctx->window, -1, 0);
-    app_ctx->renderer = SDL_CreateRenderer(app_ctx->window, -1, render_flags);
+    if (app_ctx->soft_compositor) {
+        // the window surface persists between frames and serves as the scene
+        app_ctx->window_surface = SDL_GetWindowSurface(app_ctx->window);
+        if (app_ctx->window_surface) {
+            app_ctx->renderer = SDL_CreateSoftwareRenderer(app_ctx->window_surface);
+        }
+        if (!app_ctx->renderer) {
+            error_printf("soft compositor unavailable, using the renderer %s\n", SDL_GetError());
+            app_ctx->window_surface = NULL;
+        }
+    }
+    if (app_ctx->window_surface && app_ctx->render_scale < 1.0) {
+        // damage rects are in scene pixels, window surface updates are in window pixels
+        error_printf("render_scale is unsupported with softcompositor, using 1.0\n");
+        app_ctx->render_scale = 1.0;
+    }
+    if (!app_ctx->renderer) {
+        int driver = render_select_driver(app_ctx->window, app_ctx->render_driver, app_ctx->calibrate_renderer);
+        if (driver >= 0) {
+            // the driver determines acceleration
+            app_ctx->renderer = SDL_CreateRenderer(app_ctx->window, driver, render_flags & SDL_RENDERER_PRESENTVSYNC);
+        }
+        if (!app_ctx->renderer) {
+            app_ctx->renderer = SDL_CreateRenderer(app_ctx->window, -1, render_flags);
+        }
+    }
     if (!app_ctx->renderer) {
         error_printf("creating renderer: %s\n", SDL_GetError());
         return true;
     }
     tcache_set_renderer_tid(SDL_GetThreadID(NULL));
+    if (tcache_get_auto_limit()) {
+        tcache_probe_texture_memory(app_ctx->renderer, TEXTURE_PROBE_MAX_BYTES);
+    }
     SDL_GetWindowSize(app_ctx->window, &app_ctx->screen_width, &app_ctx->screen_height);
+    if (app_ctx->render_scale < 1.0) {
+        // layout, media and the scene are all sized for the internal resolution,
+        // the logical size scales the copy to the window
+        printf("render scale %.2f: %dx%d -> ", app_ctx->render_scale, app_ctx->screen_width, app_ctx->screen_height);
+        app_ctx->screen_width = (int)(app_ctx->screen_width * app_ctx->render_scale);
+        app_ctx->screen_height = (int)(app_ctx->screen_height * app_ctx->render_scale);
+        printf("%dx%d\n", app_ctx->screen_width, app_ctx->screen_height);
+    }
     app_ctx->pixelFormat = SDL_GetWindowPixelFormat(app_ctx->window);
     app_ctx->bytes_per_pixel = SDL_BYTESPERPIXEL(app_ctx->pixelFormat);
 
@@ -235,7 +254,7 @@ bool app_initialize(app_context* app_ctx, const char* window_title) {
 
 void app_cleanup(app_context* app_ctx, int exit_status) {
     printf("app_cleanup\n");
-    close_local_player(app_ctx->player);
+    close_local_player(__atomic_load_n(&app_ctx->player, __ATOMIC_ACQUIRE));
     SDL_DestroyRenderer(app_ctx->renderer);
     SDL_DestroyWindow(app_ctx->window);
     TTF_Quit();
@@ -244,6 +263,155 @@ void app_cleanup(app_context* app_ctx, int exit_status) {
     exit(exit_status);
 }
 
+// Draw the damaged regions, into the scene texture when there is one,
+// and copy the result to the window.
+static void render_damage(app_context* app_ctx, view_context* view, SDL_Texture* scene, const widget_damage* damage) {
+    if (app_ctx->window_surface) {
+        // drawn in place, present_damage updates the display
+        widget_list_render_damage(view->list, damage);
+        SDL_RenderFlush(app_ctx->renderer);
+    } else if (scene) {
+        SDL_SetRenderTarget(app_ctx->renderer, scene);
+        widget_list_render_damage(view->list, damage);
+        SDL_SetRenderTarget(app_ctx->renderer, NULL);
+        draw_clear(app_ctx->renderer);
+        if (app_ctx->render_orientation != app_ctx->orientation) {
+            // the only rotated copy in the frame
+            draw_copy_ex(app_ctx->renderer, scene, NULL, &app_ctx->present_rect,
+                    app_ctx->orientation, NULL, SDL_FLIP_NONE);
+        } else {
+            draw_copy(app_ctx->renderer, scene, NULL, NULL);
+        }
+    } else {
+        draw_clear(app_ctx->renderer);
+        widget_list_render(view->list);
+    }
+}
+
+// Show the rendered frame, with the soft compositor only the damaged
+// regions are copied to the display, all of it if damage is NULL.
+static void present_damage(app_context* app_ctx, const widget_damage* damage) {
+    if (app_ctx->window_surface) {
+        if (damage) {
+            SDL_UpdateWindowSurfaceRects(app_ctx->window, damage->rects, damage->count);
+        } else {
+            SDL_RenderFlush(app_ctx->renderer);
+            SDL_UpdateWindowSurface(app_ctx->window);
+        }
+    } else {
+        SDL_RenderPresent(app_ctx->renderer);
+    }
+}
+
+static int compare_int64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Render bench_frames frames for each VU meter as fast as possible,
+// with synthetic levels and canned player status, and write the
+// frame time percentiles, draw and fill counts and texture bytes as JSON,
+// the meter counts are those of the VU meter widget in the last frame.
+static void bench_render_loop(app_context* app_ctx, view_context* view, SDL_Texture* scene) {
+    app_workspace_t* app_wksp = (app_workspace_t*)(&view->app->workspace);
+    int frames = app_ctx->bench_frames;
+    int64_t* frame_usecs = calloc(frames, sizeof(int64_t));
+    widget_damage damage;
+    widget* vu = NULL;
+    for (widget* widget = view->list->head.next; widget != NULL && vu == NULL; widget = widget->next) {
+        if (widget->type == WIDGET_VUMETER) {
+            vu = widget;
+        }
+    }
+    if (vu == NULL || frame_usecs == NULL) {
+        error_printf("bench: no VU meter widget\n");
+        exit(EXIT_FAILURE);
+    }
+    FILE* fp = app_ctx->bench_json ? fopen(app_ctx->bench_json, "w") : stdout;
+    if (fp == NULL) {
+        error_printf("bench: failed to open %s\n", app_ctx->bench_json);
+        exit(EXIT_FAILURE);
+    }
+
+    // canned player status, player formatted text shows the format string
+    app_wksp->player_mode = PLAYER_MODE_PLAYING;
+    for (widget* widget = view->list->head.next; widget != NULL; widget = widget->next) {
+        if (widget->type == WIDGET_TEXT && widget->sub.text.format) {
+            widget_text_set_content(widget, widget->sub.text.format);
+        } else if (widget->type == WIDGET_SLIDER) {
+            widget_slider_set_value(widget, (widget->sub.slider.range.start + widget->sub.slider.range.end)/2);
+        }
+    }
+    visualizer_vumeter_synthetic(true);
+
+    SDL_RendererInfo info;
+    SDL_GetRendererInfo(app_ctx->renderer, &info);
+    fprintf(fp, "{\n"
+            "  \"renderer\": \"%s\",\n"
+            "  \"width\": %d,\n"
+            "  \"height\": %d,\n"
+            "  \"scene\": %s,\n"
+            "  \"soft_compositor\": %s,\n"
+            "  \"frames_per_meter\": %d,\n"
+            "  \"meters\": [\n",
+            info.name, app_ctx->screen_width, app_ctx->screen_height,
+            scene ? "true" : "false", app_ctx->window_surface ? "true" : "false", frames);
+    int count = widget_vumeter_count(vu);
+    for (int ix = 0; ix < count; ++ix) {
+        int64_t t0 = get_micro_seconds();
+        widget_vumeter_select_index(vu, ix);
+        int64_t load_usecs = get_micro_seconds() - t0;
+        draw_stats draws = {0};
+        for (int frame = 0; frame < frames; ++frame) {
+            int64_t f0 = get_micro_seconds();
+            draw_stats_reset();
+            visualizer_vumeter_synthetic_step();
+            visualizer_snapshot_update(f0);
+            tcache_render_prep(app_ctx->renderer);
+            widget_list_collect_damage(view->list, &damage, true);
+            render_damage(app_ctx, view, scene, &damage);
+            present_damage(app_ctx, &damage);
+            frame_usecs[frame] = get_micro_seconds() - f0;
+            draw_stats_add(&draws, &draw_counters);
+        }
+        qsort(frame_usecs, frames, sizeof(frame_usecs[0]), compare_int64);
+        fprintf(fp, "    {\"name\": \"%s\", \"load_usecs\": %ld, "
+                "\"frame_usecs\": {\"p50\": %ld, \"p95\": %ld, \"p99\": %ld, \"max\": %ld}, "
+                "\"draw_calls_per_frame\": %.1f, \"copies_per_frame\": %.1f, "
+                "\"rotated_per_frame\": %.1f, \"scaled_per_frame\": %.1f, "
+                "\"textures_per_frame\": %.1f, \"texture_switches_per_frame\": %.1f, "
+                "\"src_pixels_per_frame\": %.0f, \"dst_pixels_per_frame\": %.0f, "
+                "\"meter\": {\"draw_calls\": %u, \"copies\": %u, \"rotated\": %u, \"scaled\": %u, "
+                "\"textures\": %u, \"src_pixels\": %lu, \"dst_pixels\": %lu}, "
+                "\"texture_bytes\": %u}%s\n",
+                widget_vumeter_name(vu), load_usecs,
+                frame_usecs[(frames - 1) * 50 / 100],
+                frame_usecs[(frames - 1) * 95 / 100],
+                frame_usecs[(frames - 1) * 99 / 100],
+                frame_usecs[frames - 1],
+                (double)draws.draw_calls / frames,
+                (double)draws.copies / frames,
+                (double)draws.rotated / frames,
+                (double)draws.scaled / frames,
+                (double)draws.textures / frames,
+                (double)draws.texture_switches / frames,
+                (double)draws.src_pixels / frames,
+                (double)draws.dst_pixels / frames,
+                vu->draw_cost.draw_calls, vu->draw_cost.copies, vu->draw_cost.rotated, vu->draw_cost.scaled,
+                vu->draw_cost.textures, vu->draw_cost.src_pixels, vu->draw_cost.dst_pixels,
+                tcache_get_texture_bytes_count(),
+                ix + 1 < count ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    if (fp != stdout) {
+        fclose(fp);
+    }
+    free(frame_usecs);
+    visualizer_vumeter_synthetic(false);
+    __atomic_clear(&render_loop, __ATOMIC_RELEASE);
+}
+
 void sdl_render_loop(view_context* view) {
     // initialisation {
     app_context* app_ctx = (app_context *)view->app;
@@ -254,6 +422,25 @@ void sdl_render_loop(view_context* view) {
     }
 
     setup_orientation(app_ctx->orientation, app_ctx->screen_width, app_ctx->screen_height, &app_ctx->window_rect);
+    app_ctx->render_orientation = app_ctx->orientation;
+    app_ctx->render_width = app_ctx->screen_width;
+    app_ctx->render_height = app_ctx->screen_height;
+    if (app_ctx->rotate_scene && app_ctx->orientation != 0) {
+        if (app_ctx->full_redraw || app_ctx->window_surface || !SDL_RenderTargetSupported(app_ctx->renderer)) {
+            error_printf("rotatescene requires a scene render target, widgets are rotated individually\n");
+        } else {
+            // widgets are laid out and drawn on an unrotated canvas
+            setup_unrotated_rendering();
+            app_ctx->render_orientation = 0;
+            app_ctx->render_width = app_ctx->window_rect.w;
+            app_ctx->render_height = app_ctx->window_rect.h;
+            // rotated about its centre the canvas fills the window
+            app_ctx->present_rect.x = (app_ctx->screen_width - app_ctx->render_width)/2;
+            app_ctx->present_rect.y = (app_ctx->screen_height - app_ctx->render_height)/2;
+            app_ctx->present_rect.w = app_ctx->render_width;
+            app_ctx->present_rect.h = app_ctx->render_height;
+        }
+    }
 
     {
         SDL_RendererInfo info;
@@ -310,18 +497,54 @@ void sdl_render_loop(view_context* view) {
         }
     }
 
-    widget_list_load_media(view->list, "./images");
-    for(widget* widget=view->list->head.next; widget != NULL; widget=widget->next) {
-        if (widget->type == WIDGET_VUMETER) {
-            widget_vumeter_select_by_name(widget, app_ctx->first_vu_meter);
+    if (app_ctx->bench_frames) {
+        widget_list_load_media(view->list, "./images");
+        for(widget* widget=view->list->head.next; widget != NULL; widget=widget->next) {
+            if (widget->type == WIDGET_VUMETER) {
+                widget_vumeter_select_by_name(widget, app_ctx->first_vu_meter);
+            }
         }
+    } else {
+        // frames are rendered while the media loads, widgets appear as they load
+        widget_list_load_media_async(view->list, "./images");
+    }
+    widget_list_create_layers(view->list);
+    // persistent back buffer, each frame only the damaged regions are redrawn
+    SDL_Texture* scene = NULL;
+    widget_damage damage;
+    if (app_ctx->window_surface) {
+        SDL_RenderClear(app_ctx->renderer);
+        widget_list_invalidate(view->list);
+    } else if (!app_ctx->full_redraw && SDL_RenderTargetSupported(app_ctx->renderer)) {
+        scene = SDL_CreateTexture(app_ctx->renderer, app_ctx->pixelFormat, SDL_TEXTUREACCESS_TARGET,
+                app_ctx->render_width, app_ctx->render_height);
+        if (scene) {
+            SDL_SetTextureBlendMode(scene, SDL_BLENDMODE_NONE);
+            // upscaled when the render scale is below 1
+            SDL_SetTextureScaleMode(scene, SDL_ScaleModeLinear);
+            SDL_SetRenderTarget(app_ctx->renderer, scene);
+            SDL_RenderClear(app_ctx->renderer);
+            SDL_SetRenderTarget(app_ctx->renderer, NULL);
+            widget_list_invalidate(view->list);
+        } else if (app_ctx->render_orientation != app_ctx->orientation) {
+            // widgets have been laid out for the unrotated canvas
+            error_printf("failed to create the unrotated scene texture %s\n", SDL_GetError());
+            exit(EXIT_FAILURE);
+        } else {
+            error_printf("failed to create scene texture, redrawing every frame %s\n", SDL_GetError());
+        }
+    }
+    if (app_ctx->bench_frames) {
+        __atomic_store_n(&app_ctx->ready, true, __ATOMIC_RELEASE);
     }
-    __atomic_store_n(&app_ctx->ready, true, __ATOMIC_RELEASE);
     // initialisation }
+
+    if (app_ctx->bench_frames) {
+        bench_render_loop(app_ctx, view, scene);
+    }
  
     bool profile_fps_deviation = app_ctx->profile_fps_deviation;
     SDL_RenderClear(app_ctx->renderer);
-    int vols[2] = {0, 0};
 
     SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
     SDL_ShowCursor(SDL_DISABLE);
@@ -334,12 +557,38 @@ void sdl_render_loop(view_context* view) {
     SDL_RenderPresent(app_ctx->renderer);
     SDL_RenderClear(app_ctx->renderer);
     SDL_RenderPresent(app_ctx->renderer);
+    if (app_ctx->window_surface) {
+        // later frames only update damaged regions
+        present_damage(app_ctx, NULL);
+    }
     int64_t ms_00 = get_micro_seconds();
-    int64_t ms_next = ms_00 + app_ctx->frame_time_micros;
+    governor_init(&app_ctx->governor);
+    quality_governor_init(app_ctx->frame_time_micros);
+    frame_timeline_init();
+    bool blanked = false;
+    frame_pacer pacer;
+    frame_pacer_init(&pacer, app_ctx->frame_time_micros, ms_00 + app_ctx->frame_time_micros - PRESENT_LEAD_MICROS);
+    // measured from vsynced presents, replaces the nominal refresh rate
+    refresh_estimator refresh;
+    refresh_estimator_init(&refresh, app_ctx->frame_time_micros);
+    // time to the first frame and to the first frame with all media
+    int64_t first_frame_usecs = 0;
+    int64_t complete_frame_usecs = 0;
+    // render calls of presented frames since the last report
+    draw_stats frame_draws = {0};
+    unsigned draw_frames = 0;
     SDL_RenderSetVSync(app_ctx->renderer, app_ctx->vsync);
 
     while (__atomic_load_n(&render_loop, __ATOMIC_ACQUIRE)) {
         int64_t ms_0 = get_micro_seconds();
+        draw_stats_reset();
+        // the loaders mark the widgets before they finish, a frame that
+        // sees loading completed draws every widget
+        bool complete = app_ctx->ready || widget_list_media_loaded(view->list);
+        if (complete && !app_ctx->ready) {
+            // input and player updates start once every widget is loaded
+            __atomic_store_n(&app_ctx->ready, true, __ATOMIC_RELEASE);
+        }
         // On linux desktop crashes in SDL_PumpEvents when switched to 
         // Assertion 'close_nointr(fd) != -EBADF' failed at src/basic/fd-util.c:69, function safe_close(). Aborting.
         //
@@ -378,35 +627,97 @@ void sdl_render_loop(view_context* view) {
 //        tcache_flush_textures(app_ctx->renderer);
 //        tcache_resolve_textures(app_ctx->renderer);
         int64_t ms_1 = get_micro_seconds();
-        visualizer_vumeter(vols);
+        // shared by all visualiser widgets rendered in this frame
+        const vis_snapshot* snap = visualizer_snapshot_update(ms_0);
         int64_t ms_2 = get_micro_seconds();
-        SDL_RenderClear(app_ctx->renderer);
+        governor_state gstate = governor_update(app_wksp->player_mode == PLAYER_MODE_PLAYING,
+                snap->peaks[0] == 0 && snap->peaks[1] == 0, ms_2);
+        if (gstate == GOVERNOR_BLANK) {
+            if (!blanked) {
+                draw_clear(app_ctx->renderer);
+                present_damage(app_ctx, NULL);
+                blanked = true;
+            }
+            governor_wait();
+            ms_00 = get_micro_seconds();
+            frame_pacer_rephase(&pacer, ms_00);
+            continue;
+        }
+        if (blanked) {
+            blanked = false;
+            widget_list_invalidate(view->list);
+        }
+
+        // nothing changed => the previous frame is still on screen
+        bool animate = governor_animate() && !quality_governor_skip_frame(render_iters);
+        widget_list_collect_damage(view->list, &damage, animate);
+        bool present = damage.count != 0 || (scene == NULL && app_ctx->window_surface == NULL && animate);
 
         int64_t ms_3 = get_micro_seconds();
 
-        for(widget* widget=view->list->head.next; widget != NULL; widget=widget->next) {
-            if (!widget->hidden) {
-                widget->render(widget);
-            }
+        if (present) {
+            render_damage(app_ctx, view, scene, &damage);
         }
         int64_t ms_4 = get_micro_seconds();
 
-        int64_t sleeptime = 0;
-        if (app_ctx->vsync == 0) {
-            sleeptime = ms_next - 1000 - get_micro_seconds();
-            sleep_micro_seconds(sleeptime);
+        int64_t late = 0;
+        if (gstate == GOVERNOR_IDLE) {
+            governor_wait();
+        } else if (app_ctx->vsync == 0 || !present) {
+            // without a present there is no vsync wait
+            late = frame_pacer_wait(&pacer);
         }
         int64_t ms_5 = get_micro_seconds();
-        SDL_RenderPresent(app_ctx->renderer);
+        if (present) {
+            present_damage(app_ctx, &damage);
+            draw_stats_add(&frame_draws, &draw_counters);
+            ++draw_frames;
+            if (first_frame_usecs == 0) {
+                first_frame_usecs = get_micro_seconds() - app_ctx->start_usecs;
+                printf("startup: first frame after %ld milliseconds\n", first_frame_usecs/1000);
+            }
+            if (complete && complete_frame_usecs == 0) {
+                complete_frame_usecs = get_micro_seconds() - app_ctx->start_usecs;
+                printf("startup: complete frame after %ld milliseconds\n", complete_frame_usecs/1000);
+            }
+        }
         int64_t ms_6 = get_micro_seconds();
+        if ((app_ctx->vsync && present) || gstate == GOVERNOR_IDLE) {
+            // vsync or the governor determine when frames go out
+            frame_pacer_rephase(&pacer, ms_6 - PRESENT_LEAD_MICROS);
+        }
+        // present returns at the vertical blank only with vsync at full rate
+        if (app_ctx->vsync && present && app_ctx->window_surface == NULL && gstate == GOVERNOR_ACTIVE) {
+            if (refresh_estimator_present(&refresh, ms_6)) {
+                app_ctx->frame_time_micros = refresh.period;
+                app_ctx->frame_time_millis = refresh.period/1000;
+                app_ctx->refresh_rate = (int)(refresh_estimator_rate(&refresh) + 0.5);
+                frame_pacer_set_period(&pacer, refresh.period);
+                quality_governor_set_period(refresh.period);
+            }
+        } else {
+            refresh_estimator_break(&refresh);
+        }
+        if (present && gstate == GOVERNOR_ACTIVE && !app_ctx->fixed_quality) {
+            // with vsync the present includes waiting for the vertical blank
+            int64_t work = ms_4 - ms_0 + (app_ctx->vsync ? 0 : ms_6 - ms_5);
+            quality_governor_frame(ms_6 - ms_00, work);
+            if (app_wksp->quality_level != quality_governor_level()) {
+                if (quality_governor_scale_mode(app_wksp->quality_level) != quality_governor_scale_mode(quality_governor_level())) {
+                    // re-render cached layers with the new scaling
+                    widget_list_invalidate(view->list);
+                }
+                app_wksp->quality_level = quality_governor_level();
+            }
+        }
 //        profile_printf("fps=%02lu t=%06lu v=%06lu rt=%06lu wr=%06lu rtwr= rp=%06lu\n",
         int64_t fps = 1000000/(ms_6 - ms_00);
         acc_fps += fps;
 //        if ( !profile_fps_deviation || (fps < 59 || fps > 61)) {
-        if ( !profile_fps_deviation || (fps < 59)) {
+        if ( !profile_fps_deviation || (fps < app_ctx->refresh_rate - 1)) {
             ++low_fps_count;
             if (app_ctx->vsync == 0) {
-                profile_printf("fps=%03ld t=%06ld pr=%06ld v=%06ld rc=%06ld wr=%06ld s=%06ld rp=%06ld pe=%06ld off= %06ld rp+s=%06ld xs=%06ld \n",
+                profile_printf("fps=%03ld t=%06ld pr=%06ld v=%06ld rc=%06ld wr=%06ld s=%06ld rp=%06ld pe=%06ld late=%06ld rp+s=%06ld\n",
                     fps,
                     ms_6 - ms_00, //t
                     ms_1 - ms_pe, //pr
@@ -416,9 +727,8 @@ void sdl_render_loop(view_context* view) {
                     ms_5 - ms_4, //s
                     ms_6 - ms_5, //rp
                     ms_pe - ms_0, //pe
-                    ms_6 - ms_next,
-                    ms_6 - ms_4, //rp +s
-                    ms_5 - ms_4 - sleeptime
+                    late,
+                    ms_6 - ms_4 //rp +s
                    );
             } else {
                 profile_printf("fps=%03ld t=%06ld pr=%06ld v=%06ld rc=%06ld wr=%06ld rp=%06ld pe=%06ld ct=%06ld\n",
@@ -435,8 +745,21 @@ void sdl_render_loop(view_context* view) {
             }
         }
         ++render_iters;
+        {
+            int64_t marks[FT_MARK_COUNT] = {ms_0, ms_pe, ms_1, ms_2, ms_3, ms_4, ms_5, ms_6};
+            frame_timeline_record(marks);
+            frame_timeline_poll();
+        }
         ms_00 = ms_6;
-        ms_next += app_ctx->frame_time_micros;
+        if (pacer.frames == PACER_REPORT_FRAMES) {
+            frame_pacer_report(&pacer, perf_printf);
+            frame_pacer_reset_stats(&pacer);
+            quality_governor_report(perf_printf);
+            draw_stats_report("draw stats", &frame_draws, draw_frames, perf_printf);
+            widget_list_report_draw_stats(view->list, perf_printf);
+            memset(&frame_draws, 0, sizeof(frame_draws));
+            draw_frames = 0;
+        }
         ++fps_sample_counter;
         if ( FPS_SAMPLE_COUNT == fps_sample_counter) {
             app_wksp->reported_fps = acc_fps/FPS_SAMPLE_COUNT;
@@ -445,8 +768,18 @@ void sdl_render_loop(view_context* view) {
         }
 //        SDL_ShowCursor(show_cursor != 0 ? SDL_ENABLE : SDL_DISABLE);
     }
+    if (scene) {
+        SDL_DestroyTexture(scene);
+    }
+    widget_list_destroy_layers(view->list);
+    governor_shutdown();
+    quality_governor_shutdown();
     tcache_shutdown();
     profile_printf("low_fps_count=%u/%u %f\n", low_fps_count, render_iters, (float)low_fps_count*100/render_iters);
+    frame_pacer_report(&pacer, profile_printf);
+    quality_governor_report(profile_printf);
+    frame_timeline_report(profile_printf);
+    draw_stats_report("draw stats", &frame_draws, draw_frames, profile_printf);
     debug_printf("*** render loop end ****\n");
 }
 
@@ -465,6 +798,7 @@ void sdl_input_loop(view_context* view) {
         int64_t t0 = get_micro_seconds();
         SDL_Event event;
         while(SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) {
+            governor_wake();
             switch (event.type) {
             case USEREVENT_NEXT_VISU:
             case USEREVENT_NEXT_VU:
@@ -507,6 +841,9 @@ void sdl_input_loop(view_context* view) {
                 case SDL_SCANCODE_T:
                     tcache_dump();
                     break;
+                case SDL_SCANCODE_P:
+                    frame_timeline_request_dump();
+                    break;
                 default:
                     break;
                 }
@@ -545,7 +882,11 @@ void sdl_input_loop(view_context* view) {
                 break;
             case USEREVENT_FINGERMOTION:
                 {
-                    SDL_Point pt = { .x = event.motion.x, .y = event.motion.y };
+                    // touch screen coordinates are window pixels
+                    SDL_Point pt = {
+                        .x = (int)(event.motion.x * app_ctx->render_scale),
+                        .y = (int)(event.motion.y * app_ctx->render_scale)
+                    };
                     widget_list_react(view->list, POINTER_MOTION, &pt);
                 } break;
             case SDL_FINGERDOWN:
@@ -561,7 +902,11 @@ void sdl_input_loop(view_context* view) {
                 break;
             case USEREVENT_FINGERDOWN:
                 {
-                    SDL_Point pt = { .x = event.motion.x, .y = event.motion.y };
+                    // touch screen coordinates are window pixels
+                    SDL_Point pt = {
+                        .x = (int)(event.motion.x * app_ctx->render_scale),
+                        .y = (int)(event.motion.y * app_ctx->render_scale)
+                    };
                     widget_list_react(view->list, POINTER_DOWN, &pt);
                 } break;
             case SDL_FINGERUP:
@@ -577,7 +922,11 @@ void sdl_input_loop(view_context* view) {
                 break;
             case USEREVENT_FINGERUP:
                 {
-                    SDL_Point pt = { .x = event.motion.x, .y = event.motion.y };
+                    // touch screen coordinates are window pixels
+                    SDL_Point pt = {
+                        .x = (int)(event.motion.x * app_ctx->render_scale),
+                        .y = (int)(event.motion.y * app_ctx->render_scale)
+                    };
                     widget_list_react(view->list, POINTER_UP, &pt);
                 } break;
             default:
@@ -623,7 +972,8 @@ void player_poll_loop(view_context* view) {
     char buffer[512];
     uint64_t sig=0;
 
-    while(__atomic_load_n(&app_ctx->ready, __ATOMIC_ACQUIRE) == 0) {
+    while(__atomic_load_n(&app_ctx->ready, __ATOMIC_ACQUIRE) == 0
+            || __atomic_load_n(&app_ctx->player, __ATOMIC_ACQUIRE) == NULL) {
         sleep_milli_seconds(100);
     }
 
@@ -710,6 +1060,9 @@ void player_poll_loop(view_context* view) {
                 if (app_wksp->player_mode != pv.integer) {
                     app_wksp->player_mode = pv.integer;
                     app_wksp->player_mode_start_timestamp = get_milli_seconds();
+                    if (pv.integer == PLAYER_MODE_PLAYING) {
+                        governor_wake();
+                    }
                 }
             }
         }
@@ -742,7 +1095,11 @@ void player_poll_loop(view_context* view) {
             if (t->runtime_value_key) {
                 if (t->type == WIDGET_TEXT) {
                     if(0 == strcmp("fps", t->runtime_value_key)) {
-                        snprintf(buffer, sizeof(buffer), "FPS:%u", app_wksp->reported_fps);
+                        if (app_wksp->quality_level) {
+                            snprintf(buffer, sizeof(buffer), "FPS:%u Q:%u", app_wksp->reported_fps, app_wksp->quality_level);
+                        } else {
+                            snprintf(buffer, sizeof(buffer), "FPS:%u", app_wksp->reported_fps);
+                        }
                         widget_text_set_content(t, buffer);
                     }
                 }
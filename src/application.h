@@ -3,9 +3,12 @@
 #define __jl_application_h_
 #include "types.h"
 #include "lyrion_player.h"
+#include "frame_governor.h"
 
 typedef struct {
     unsigned  reported_fps;
+    // degradation level of the quality governor, 0 is full quality
+    unsigned  quality_level;
     player_mode_t   player_mode;
     int64_t         player_mode_start_timestamp;
 } app_workspace_t;
@@ -13,6 +16,15 @@ typedef struct {
 typedef struct app_context {
     float           orientation;
     SDL_Rect        window_rect;
+    // render the scene unrotated and rotate it once when presenting
+    bool            rotate_scene;
+    // orientation and size of the canvas widgets are drawn on,
+    // unrotated and window_rect sized with rotate_scene
+    float           render_orientation;
+    int             render_width;
+    int             render_height;
+    // where the canvas is copied to in the window with rotate_scene
+    SDL_Rect        present_rect;
     SDL_Renderer*   renderer;
     const SDL_threadID   renderer_tid;
     Uint32          pixelFormat;
@@ -20,11 +32,31 @@ typedef struct app_context {
     SDL_Window*     window;
     bool            fullscreen;
 
+    // internal render resolution, window size scaled by render_scale
     int             screen_width;
     int             screen_height;
+    // < 1 renders at a lower resolution, upscaled once when presented
+    float           render_scale;
     int             max_secs;
     int             cycle_secs;
     int             vsync;
+    // redraw every widget every frame instead of damaged regions
+    bool            full_redraw;
+    // draw directly into the window surface with the software renderer,
+    // only damaged regions of the surface are updated on the display
+    bool            soft_compositor;
+    SDL_Surface*    window_surface;
+    // SDL render driver name, NULL => cached calibration or SDL default
+    const char*     render_driver;
+    // time each render driver at startup and cache the fastest
+    bool            calibrate_renderer;
+    governor_config governor;
+    // do not degrade rendering when frames are late
+    bool            fixed_quality;
+    // headless benchmark, frames rendered per VU meter
+    int             bench_frames;
+    // benchmark results file, stdout if NULL
+    const char*     bench_json;
 
     int             refresh_rate;
     int             frame_time_millis;
@@ -32,6 +64,7 @@ typedef struct app_context {
 
     bool            profile_fps_deviation;
     const           char* lms;
+    // opened by a startup thread, NULL until then
     player_ptr      player;
 
     const char*     window_title;
@@ -39,7 +72,10 @@ typedef struct app_context {
     bool            dump_vu;
     const char*     first_vu_meter;
 
+    // set when the media of every widget is loaded
     bool            ready;
+    // get_micro_seconds() at process start
+    int64_t         start_usecs;
     const char*     default_font_path;
 
     int             max_texture_width;
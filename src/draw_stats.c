@@ -0,0 +1,131 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <string.h>
+#include "draw_stats.h"
+
+// distinct textures tracked per frame, further textures are not counted
+#define DRAW_STATS_TEXTURES 64
+
+draw_stats draw_counters;
+
+static uint32_t frame;
+static const SDL_Texture* last_texture;
+static const SDL_Texture* textures[DRAW_STATS_TEXTURES];
+
+void draw_stats_reset(void) {
+    memset(&draw_counters, 0, sizeof(draw_counters));
+    last_texture = NULL;
+    ++frame;
+}
+
+uint32_t draw_stats_frame(void) {
+    return frame;
+}
+
+// size of the current render target
+static void target_size(SDL_Renderer* renderer, int* w, int* h) {
+    SDL_Texture* target = SDL_GetRenderTarget(renderer);
+    if (target) {
+        SDL_QueryTexture(target, NULL, NULL, w, h);
+    } else {
+        SDL_GetRendererOutputSize(renderer, w, h);
+    }
+}
+
+void draw_stats_copy(SDL_Renderer* renderer, SDL_Texture* texture,
+        const SDL_Rect* src_rect, const SDL_Rect* dst_rect, double angle) {
+    // SDL_RenderCopy fails for a NULL texture, nothing is drawn
+    if (texture == NULL) {
+        return;
+    }
+    int sw = 0, sh = 0, dw = 0, dh = 0;
+    if (src_rect) {
+        sw = src_rect->w;
+        sh = src_rect->h;
+    } else {
+        SDL_QueryTexture(texture, NULL, NULL, &sw, &sh);
+    }
+    if (dst_rect) {
+        dw = dst_rect->w;
+        dh = dst_rect->h;
+    } else {
+        target_size(renderer, &dw, &dh);
+    }
+    ++draw_counters.copies;
+    draw_counters.src_pixels += (uint64_t)sw * sh;
+    draw_counters.dst_pixels += (uint64_t)dw * dh;
+    if (angle != 0) {
+        ++draw_counters.rotated;
+    }
+    if (sw != dw || sh != dh) {
+        ++draw_counters.scaled;
+    }
+    if (texture != last_texture) {
+        last_texture = texture;
+        ++draw_counters.texture_switches;
+        unsigned ix = 0;
+        unsigned count = draw_counters.textures < DRAW_STATS_TEXTURES ? draw_counters.textures : DRAW_STATS_TEXTURES;
+        for (; ix < count && textures[ix] != texture; ++ix) {
+        }
+        if (ix == count) {
+            if (ix < DRAW_STATS_TEXTURES) {
+                textures[ix] = texture;
+            }
+            ++draw_counters.textures;
+        }
+    }
+}
+
+void draw_stats_fill(SDL_Renderer* renderer, const SDL_Rect* rect) {
+    int w, h;
+    if (rect) {
+        w = rect->w;
+        h = rect->h;
+    } else {
+        target_size(renderer, &w, &h);
+    }
+    draw_counters.dst_pixels += (uint64_t)w * h;
+}
+
+void draw_stats_add(draw_stats* total, const draw_stats* counts) {
+    total->draw_calls += counts->draw_calls;
+    total->copies += counts->copies;
+    total->rotated += counts->rotated;
+    total->scaled += counts->scaled;
+    total->textures += counts->textures;
+    total->texture_switches += counts->texture_switches;
+    total->src_pixels += counts->src_pixels;
+    total->dst_pixels += counts->dst_pixels;
+}
+
+void draw_stats_since(const draw_stats* start, draw_stats* counts) {
+    counts->draw_calls = draw_counters.draw_calls - start->draw_calls;
+    counts->copies = draw_counters.copies - start->copies;
+    counts->rotated = draw_counters.rotated - start->rotated;
+    counts->scaled = draw_counters.scaled - start->scaled;
+    counts->textures = draw_counters.textures - start->textures;
+    counts->texture_switches = draw_counters.texture_switches - start->texture_switches;
+    counts->src_pixels = draw_counters.src_pixels - start->src_pixels;
+    counts->dst_pixels = draw_counters.dst_pixels - start->dst_pixels;
+}
+
+void draw_stats_report(const char* label, const draw_stats* total, unsigned frames,
+        void (*printer)(char *format, ...)) {
+    if (frames == 0) {
+        return;
+    }
+    printer("%s: per frame draws=%.1f copies=%.1f rotated=%.1f scaled=%.1f textures=%.1f switches=%.1f src_px=%.0f dst_px=%.0f\n",
+            label,
+            (double)total->draw_calls / frames,
+            (double)total->copies / frames,
+            (double)total->rotated / frames,
+            (double)total->scaled / frames,
+            (double)total->textures / frames,
+            (double)total->texture_switches / frames,
+            (double)total->src_pixels / frames,
+            (double)total->dst_pixels / frames);
+}
@@ -0,0 +1,81 @@
+#ifndef __jl_draw_stats_h_
+#define __jl_draw_stats_h_
+#include <SDL2/SDL.h>
+#include <stdint.h>
+
+// Counts of render calls issued and pixels touched, render thread only.
+// Render calls go through the wrappers below so that they are counted.
+typedef struct {
+    uint32_t draw_calls;
+    // texture copies, each quad of a geometry batch is a copy
+    uint32_t copies;
+    uint32_t rotated;
+    // destination size differs from the source size
+    uint32_t scaled;
+    // distinct textures copied from, counted when first used in the frame
+    uint32_t textures;
+    // copies from a different texture than the previous copy
+    uint32_t texture_switches;
+    uint64_t src_pixels;
+    // copies, fills and clears
+    uint64_t dst_pixels;
+} draw_stats;
+
+extern draw_stats draw_counters;
+
+// start of a frame
+void draw_stats_reset(void);
+// frames counted by draw_stats_reset, identifies the current frame
+uint32_t draw_stats_frame(void);
+// account a copy of src_rect of texture to dst_rect, NULL => whole texture or target
+void draw_stats_copy(SDL_Renderer* renderer, SDL_Texture* texture,
+        const SDL_Rect* src_rect, const SDL_Rect* dst_rect, double angle);
+void draw_stats_fill(SDL_Renderer* renderer, const SDL_Rect* rect);
+// total += counts, or counts since start
+void draw_stats_add(draw_stats* total, const draw_stats* counts);
+void draw_stats_since(const draw_stats* start, draw_stats* counts);
+void draw_stats_report(const char* label, const draw_stats* total, unsigned frames,
+        void (*printer)(char *format, ...));
+
+static inline int draw_copy_ex(SDL_Renderer* renderer, SDL_Texture* texture,
+        const SDL_Rect* src_rect, const SDL_Rect* dst_rect,
+        const double angle, const SDL_Point* centre, const SDL_RendererFlip flip) {
+    ++draw_counters.draw_calls;
+    draw_stats_copy(renderer, texture, src_rect, dst_rect, angle);
+    return SDL_RenderCopyEx(renderer, texture, src_rect, dst_rect, angle, centre, flip);
+}
+
+static inline int draw_copy(SDL_Renderer* renderer, SDL_Texture* texture,
+        const SDL_Rect* src_rect, const SDL_Rect* dst_rect) {
+    ++draw_counters.draw_calls;
+    draw_stats_copy(renderer, texture, src_rect, dst_rect, 0);
+    return SDL_RenderCopy(renderer, texture, src_rect, dst_rect);
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+// the copies in the geometry are accounted by the caller
+static inline int draw_geometry(SDL_Renderer* renderer, SDL_Texture* texture,
+        const SDL_Vertex* vertices, int num_vertices, const int* indices, int num_indices) {
+    ++draw_counters.draw_calls;
+    return SDL_RenderGeometry(renderer, texture, vertices, num_vertices, indices, num_indices);
+}
+#endif
+
+static inline int draw_fill_rect(SDL_Renderer* renderer, const SDL_Rect* rect) {
+    ++draw_counters.draw_calls;
+    draw_stats_fill(renderer, rect);
+    return SDL_RenderFillRect(renderer, rect);
+}
+
+static inline int draw_outline(SDL_Renderer* renderer, const SDL_Rect* rect) {
+    ++draw_counters.draw_calls;
+    return SDL_RenderDrawRect(renderer, rect);
+}
+
+static inline int draw_clear(SDL_Renderer* renderer) {
+    ++draw_counters.draw_calls;
+    draw_stats_fill(renderer, NULL);
+    return SDL_RenderClear(renderer);
+}
+
+#endif // __jl_draw_stats_h_
@@ -0,0 +1,137 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "frame_governor.h"
+#include "logging.h"
+#include "timing.h"
+
+// Events are pumped on the render thread, so the wait is bounded
+// even when nothing is rendered.
+#define GOVERNOR_POLL_MICROS 50000
+
+extern int platform_set_display_power(int on);
+
+static const char* state_names[] = {
+    "active",
+    "idle",
+    "blank",
+};
+
+static governor_config config;
+static governor_state state = GOVERNOR_ACTIVE;
+// render thread only
+static int64_t quiet_since;
+static int64_t stopped_since;
+static int64_t next_idle_frame;
+static bool animate;
+// written by any thread
+static int64_t atomic_wake_time;
+static bool woken;
+static SDL_mutex* mutex;
+static SDL_cond* cond;
+
+void governor_init(const governor_config* cfg) {
+    config = *cfg;
+    mutex = SDL_CreateMutex();
+    cond = SDL_CreateCond();
+    if (mutex == NULL || cond == NULL) {
+        error_printf("governor_init: failed to create mutex or condition %s\n", SDL_GetError());
+        exit(EXIT_FAILURE);
+    }
+    __atomic_store_n(&atomic_wake_time, get_micro_seconds(), __ATOMIC_RELEASE);
+    animate = true;
+}
+
+void governor_shutdown(void) {
+    if (state == GOVERNOR_BLANK) {
+        platform_set_display_power(true);
+    }
+    state = GOVERNOR_ACTIVE;
+    SDL_DestroyCond(cond);
+    SDL_DestroyMutex(mutex);
+    cond = NULL;
+    mutex = NULL;
+}
+
+void governor_wake(void) {
+    __atomic_store_n(&atomic_wake_time, get_micro_seconds(), __ATOMIC_RELEASE);
+    if (mutex) {
+        SDL_LockMutex(mutex);
+        woken = true;
+        SDL_CondSignal(cond);
+        SDL_UnlockMutex(mutex);
+    }
+}
+
+// time since start, or since the last wake up if that was later
+static inline int64_t elapsed_since(int64_t start, int64_t wake_time, int64_t now) {
+    if (start == 0) {
+        return 0;
+    }
+    return now - (start > wake_time ? start : wake_time);
+}
+
+governor_state governor_update(bool playing, bool silent, int64_t now) {
+    int64_t wake_time = __atomic_load_n(&atomic_wake_time, __ATOMIC_ACQUIRE);
+    // audio without a player connection counts as playing
+    playing = playing || !silent;
+    if (playing && !silent) {
+        quiet_since = 0;
+    } else if (quiet_since == 0) {
+        quiet_since = now;
+    }
+    if (playing) {
+        stopped_since = 0;
+    } else if (stopped_since == 0) {
+        stopped_since = now;
+    }
+
+    governor_state next = GOVERNOR_ACTIVE;
+    if (config.blank_secs && elapsed_since(stopped_since, wake_time, now) >= (int64_t)config.blank_secs * 1000000) {
+        next = GOVERNOR_BLANK;
+    } else if (config.idle_secs && elapsed_since(quiet_since, wake_time, now) >= (int64_t)config.idle_secs * 1000000) {
+        next = GOVERNOR_IDLE;
+    }
+    if (next != state) {
+        perf_printf("governor: %s -> %s\n", state_names[state], state_names[next]);
+        if (next == GOVERNOR_BLANK) {
+            platform_set_display_power(false);
+        } else if (state == GOVERNOR_BLANK) {
+            platform_set_display_power(true);
+        }
+        state = next;
+        next_idle_frame = now;
+    }
+
+    animate = state == GOVERNOR_ACTIVE;
+    if (state == GOVERNOR_IDLE && config.idle_fps > 0 && now >= next_idle_frame) {
+        animate = true;
+        next_idle_frame = now + 1000000/config.idle_fps;
+    }
+    return state;
+}
+
+bool governor_animate(void) {
+    return animate;
+}
+
+void governor_wait(void) {
+    int64_t timeout = GOVERNOR_POLL_MICROS;
+    if (state == GOVERNOR_IDLE && config.idle_fps > 0) {
+        int64_t until_frame = next_idle_frame - get_micro_seconds();
+        if (until_frame < timeout) {
+            timeout = until_frame > 0 ? until_frame : 0;
+        }
+    }
+    SDL_LockMutex(mutex);
+    if (!woken) {
+        SDL_CondWaitTimeout(cond, mutex, (Uint32)(timeout/1000));
+    }
+    woken = false;
+    SDL_UnlockMutex(mutex);
+}
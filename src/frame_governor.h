@@ -0,0 +1,37 @@
+#ifndef __jl_frame_governor_h_
+#define __jl_frame_governor_h_
+#include <stdint.h>
+#include "types.h"
+
+typedef enum {
+    // full frame rate
+    GOVERNOR_ACTIVE,
+    // low frame rate, or render only on change
+    GOVERNOR_IDLE,
+    // nothing is rendered, the screen is black or off
+    GOVERNOR_BLANK,
+} governor_state;
+
+typedef struct {
+    // frame rate when idle, 0 => render only when widgets change
+    int idle_fps;
+    // seconds of silence, pause or stop before idling, 0 => never idle
+    int idle_secs;
+    // seconds not playing before blanking, 0 => never blank
+    int blank_secs;
+} governor_config;
+
+// render thread
+void governor_init(const governor_config* config);
+void governor_shutdown(void);
+// Evaluate the state for this frame, now is get_micro_seconds().
+governor_state governor_update(bool playing, bool silent, int64_t now);
+// Whether animated widgets should be redrawn in the current state.
+bool governor_animate(void);
+// Wait for the next frame of the current state, returns early when woken.
+void governor_wait(void);
+
+// any thread, input activity or playback start
+void governor_wake(void);
+
+#endif // __jl_frame_governor_h_
@@ -0,0 +1,114 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <string.h>
+#include "frame_pacer.h"
+#include "timing.h"
+
+#define SPIN_MIN_USECS 50
+#define SPIN_MAX_USECS 2000
+
+static void record_jitter(frame_pacer* pacer, int64_t jitter) {
+    int64_t bucket = jitter/FRAME_PACER_JITTER_BUCKET_USECS;
+    if (bucket < 0) {
+        bucket = 0;
+    } else if (bucket >= FRAME_PACER_JITTER_BUCKETS) {
+        bucket = FRAME_PACER_JITTER_BUCKETS - 1;
+    }
+    ++pacer->jitter_hist[bucket];
+    ++pacer->jitter_count;
+}
+
+void frame_pacer_init(frame_pacer* pacer, int64_t period, int64_t deadline) {
+    memset(pacer, 0, sizeof(*pacer));
+    pacer->period = period;
+    pacer->deadline = deadline;
+    pacer->spin_usecs = SPIN_MIN_USECS * 4;
+}
+
+void frame_pacer_set_period(frame_pacer* pacer, int64_t period) {
+    pacer->deadline += period - pacer->period;
+    pacer->period = period;
+}
+
+void frame_pacer_rephase(frame_pacer* pacer, int64_t timestamp) {
+    pacer->deadline = timestamp + pacer->period;
+}
+
+int64_t frame_pacer_wait(frame_pacer* pacer) {
+    int64_t now = get_micro_seconds();
+    int64_t late = now - pacer->deadline;
+    ++pacer->frames;
+    if (late > 0) {
+        ++pacer->overruns;
+        record_jitter(pacer, late);
+        if (late >= pacer->period/2) {
+            // Too late for this slot, do not try to catch up by
+            // shortening the following frames, start a new phase from now.
+            // The slots passed while late and the one the new phase
+            // moves past are skipped.
+            pacer->skipped += late/pacer->period + 1;
+            pacer->deadline = now + pacer->period;
+        } else {
+            pacer->deadline += pacer->period;
+        }
+        return late;
+    }
+
+    // sleep for most of the interval, the scheduler wake up
+    // latency is covered by spinning for the last part
+    int64_t wake = pacer->deadline - pacer->spin_usecs;
+    if (wake > now) {
+        sleep_until_micro_seconds(wake);
+        int64_t oversleep = get_micro_seconds() - wake;
+        pacer->oversleep_avg += (oversleep - pacer->oversleep_avg)/8;
+        pacer->spin_usecs = 2 * pacer->oversleep_avg + SPIN_MIN_USECS;
+        if (pacer->spin_usecs > SPIN_MAX_USECS) {
+            pacer->spin_usecs = SPIN_MAX_USECS;
+        }
+    }
+    do {
+        now = get_micro_seconds();
+    } while (now < pacer->deadline);
+
+    late = now - pacer->deadline;
+    record_jitter(pacer, late);
+    pacer->deadline += pacer->period;
+    return late;
+}
+
+// upper bound of the histogram bucket containing the percentile
+int64_t frame_pacer_jitter_percentile(const frame_pacer* pacer, unsigned percent) {
+    uint64_t target = ((uint64_t)pacer->jitter_count * percent + 99)/100;
+    uint64_t count = 0;
+    if (pacer->jitter_count == 0) {
+        return 0;
+    }
+    for (int ix = 0; ix < FRAME_PACER_JITTER_BUCKETS; ++ix) {
+        count += pacer->jitter_hist[ix];
+        if (count >= target) {
+            return (int64_t)(ix + 1) * FRAME_PACER_JITTER_BUCKET_USECS;
+        }
+    }
+    return (int64_t)FRAME_PACER_JITTER_BUCKETS * FRAME_PACER_JITTER_BUCKET_USECS;
+}
+
+void frame_pacer_report(const frame_pacer* pacer, void (*printer)(char *format, ...)) {
+    printer("pacer: period=%ld frames=%u overruns=%u skipped=%u spin=%ld jitter p50=%ld p99=%ld usecs\n",
+            pacer->period,
+            pacer->frames,
+            pacer->overruns,
+            pacer->skipped,
+            pacer->spin_usecs,
+            frame_pacer_jitter_percentile(pacer, 50),
+            frame_pacer_jitter_percentile(pacer, 99));
+}
+
+void frame_pacer_reset_stats(frame_pacer* pacer) {
+    pacer->frames = pacer->overruns = pacer->skipped = 0;
+    pacer->jitter_count = 0;
+    memset(pacer->jitter_hist, 0, sizeof(pacer->jitter_hist));
+}
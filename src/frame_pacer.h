@@ -0,0 +1,36 @@
+#ifndef __jl_frame_pacer_h_
+#define __jl_frame_pacer_h_
+#include <stdint.h>
+
+// jitter histogram, 10 microsecond buckets, the last bucket collects the rest
+#define FRAME_PACER_JITTER_BUCKET_USECS 10
+#define FRAME_PACER_JITTER_BUCKETS 200
+
+typedef struct {
+    int64_t  period;
+    // absolute time (get_micro_seconds) of the next frame
+    int64_t  deadline;
+    // the last part of the wait is spent spinning,
+    // sized from the observed oversleep of clock_nanosleep
+    int64_t  spin_usecs;
+    int64_t  oversleep_avg;
+    unsigned frames;
+    unsigned overruns;
+    unsigned skipped;
+    unsigned jitter_count;
+    uint32_t jitter_hist[FRAME_PACER_JITTER_BUCKETS];
+} frame_pacer;
+
+void frame_pacer_init(frame_pacer* pacer, int64_t period, int64_t deadline);
+void frame_pacer_set_period(frame_pacer* pacer, int64_t period);
+// Move the next deadline to one period after timestamp,
+// used when something else (vsync) determined when the frame went out.
+void frame_pacer_rephase(frame_pacer* pacer, int64_t timestamp);
+// Wait for the current deadline and advance to the next one.
+// Returns how late the wait returned in microseconds.
+int64_t frame_pacer_wait(frame_pacer* pacer);
+int64_t frame_pacer_jitter_percentile(const frame_pacer* pacer, unsigned percent);
+void frame_pacer_report(const frame_pacer* pacer, void (*printer)(char *format, ...));
+void frame_pacer_reset_stats(frame_pacer* pacer);
+
+#endif // __jl_frame_pacer_h_
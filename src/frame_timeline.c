@@ -0,0 +1,148 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "frame_timeline.h"
+#include "logging.h"
+
+#define TRACE_PATH_FORMAT "/tmp/sqvumeter-trace-%d-%u.json"
+
+static const char* phase_names[FT_MARK_COUNT] = {
+    "frame",
+    "events",
+    "tcache_prep",
+    "visualizer",
+    "damage",
+    "widgets",
+    "wait",
+    "present",
+};
+
+// render thread only
+static int64_t frames[FRAME_TIMELINE_FRAMES][FT_MARK_COUNT];
+static uint32_t frame_count;
+static unsigned dump_count;
+// set from any thread or a signal handler
+static int atomic_dump_requested;
+
+static void timeline_printf(char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static void request_dump_handler(int signum) {
+    frame_timeline_request_dump();
+}
+
+void frame_timeline_init(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_dump_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR1, &sa, NULL)) {
+        error_printf("frame_timeline_init: failed to install SIGUSR1 handler\n");
+    }
+    frame_count = 0;
+}
+
+void frame_timeline_request_dump(void) {
+    __atomic_store_n(&atomic_dump_requested, 1, __ATOMIC_RELEASE);
+}
+
+void frame_timeline_record(const int64_t marks[FT_MARK_COUNT]) {
+    memcpy(frames[frame_count & (FRAME_TIMELINE_FRAMES - 1)], marks, sizeof(frames[0]));
+    ++frame_count;
+}
+
+static inline unsigned recorded_frames(void) {
+    return frame_count < FRAME_TIMELINE_FRAMES ? frame_count : FRAME_TIMELINE_FRAMES;
+}
+
+// index of the oldest recorded frame
+static inline unsigned first_frame(void) {
+    return frame_count < FRAME_TIMELINE_FRAMES ? 0 : frame_count & (FRAME_TIMELINE_FRAMES - 1);
+}
+
+static int compare_int64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static inline int64_t phase_duration(const int64_t* marks, int phase) {
+    // FT_START stands for the whole frame
+    return phase == FT_START ? marks[FT_PRESENT] - marks[FT_START] : marks[phase] - marks[phase - 1];
+}
+
+void frame_timeline_report(void (*printer)(char *format, ...)) {
+    static int64_t durations[FRAME_TIMELINE_FRAMES];
+    unsigned count = recorded_frames();
+    if (count == 0) {
+        return;
+    }
+    printer("frame timeline: %u frames, usecs    p50      p95      p99      max\n", count);
+    for (int phase = 0; phase < FT_MARK_COUNT; ++phase) {
+        for (unsigned ix = 0; ix < count; ++ix) {
+            durations[ix] = phase_duration(frames[ix], phase);
+        }
+        qsort(durations, count, sizeof(durations[0]), compare_int64);
+        printer("    %-12s %8ld %8ld %8ld %8ld\n",
+                phase_names[phase],
+                durations[(count - 1) * 50 / 100],
+                durations[(count - 1) * 95 / 100],
+                durations[(count - 1) * 99 / 100],
+                durations[count - 1]);
+    }
+}
+
+int frame_timeline_write_trace(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL) {
+        error_printf("frame_timeline_write_trace: failed to open %s\n", path);
+        return -1;
+    }
+    unsigned count = recorded_frames();
+    unsigned first = first_frame();
+    const char* sep = "";
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (unsigned n = 0; n < count; ++n) {
+        const int64_t* marks = frames[(first + n) & (FRAME_TIMELINE_FRAMES - 1)];
+        for (int phase = 0; phase < FT_MARK_COUNT; ++phase) {
+            // complete events, the frame encloses its phases
+            fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%ld,\"dur\":%ld}",
+                    sep,
+                    phase_names[phase],
+                    phase == FT_START ? marks[FT_START] : marks[phase - 1],
+                    phase_duration(marks, phase));
+            sep = ",\n";
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    if (fclose(fp)) {
+        error_printf("frame_timeline_write_trace: failed to write %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+void frame_timeline_poll(void) {
+    if (__atomic_exchange_n(&atomic_dump_requested, 0, __ATOMIC_ACQ_REL)) {
+        char path[128];
+        snprintf(path, sizeof(path), TRACE_PATH_FORMAT, (int)getpid(), dump_count++);
+        frame_timeline_report(timeline_printf);
+        if (0 == frame_timeline_write_trace(path)) {
+            printf("frame timeline: trace written to %s\n", path);
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef __jl_frame_timeline_h_
+#define __jl_frame_timeline_h_
+#include <stdint.h>
+
+// timestamps taken in the render loop, each phase ends at its mark
+typedef enum {
+    FT_START,
+    FT_EVENTS,
+    FT_TCACHE_PREP,
+    FT_VISUALIZER,
+    FT_DAMAGE,
+    FT_WIDGETS,
+    FT_WAIT,
+    FT_PRESENT,
+    FT_MARK_COUNT
+} ft_mark;
+
+// number of frames kept, a power of 2
+#define FRAME_TIMELINE_FRAMES 2048
+
+// render thread
+void frame_timeline_init(void);
+void frame_timeline_record(const int64_t marks[FT_MARK_COUNT]);
+// p50/p95/p99/max of each phase over the recorded frames
+void frame_timeline_report(void (*printer)(char *format, ...));
+// write the recorded frames as Chrome trace event JSON,
+// returns 0 on success
+int frame_timeline_write_trace(const char* path);
+// handle a pending dump request, call once per frame
+void frame_timeline_poll(void);
+
+// any thread or signal handler
+void frame_timeline_request_dump(void);
+
+#endif // __jl_frame_timeline_h_
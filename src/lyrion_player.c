@@ -1687,18 +1687,22 @@ END:
 }
 
 void player_volume_set(player_ptr player, int level) {
-    level = level < 0 ? 0 : level;
-    level = level > 100 ? 100: level;
-    lms_command(player, "mixer volume %d", level);
+    if (player) {
+        level = level < 0 ? 0 : level;
+        level = level > 100 ? 100: level;
+        lms_command(player, "mixer volume %d", level);
+    }
 }
 
 void player_volume_nudge(player_ptr player, int delta) {
-    int volume = player->volume + delta;
-    player_volume_set(player, volume);
+    if (player) {
+        int volume = player->volume + delta;
+        player_volume_set(player, volume);
+    }
 }
 
 void player_seek(player_ptr player, int seek_time) {
-    if (player->status.can_seek) {
+    if (player && player->status.can_seek) {
         seek_time = seek_time < 0 ? 0 : seek_time;
         if (player->status.duration > 0 && seek_time < player->status.duration) {
             lms_command(player, "time %d", seek_time);
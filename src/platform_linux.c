@@ -14,6 +14,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <glob.h>
 
 
 // search first 4 interfaces returned by IFCONF - same method used by squeezelite
@@ -67,3 +68,22 @@ char *platform_get_mac_address() {
 	return macaddr;
 }
 
+
+// switch the backlight of the first backlight class device on or off,
+// returns -1 if there is no such device or it is not writable
+int platform_set_display_power(int on) {
+    glob_t gl;
+    int done = -1;
+    if (0 == glob("/sys/class/backlight/*/bl_power", 0, NULL, &gl)) {
+        FILE* fp = fopen(gl.gl_pathv[0], "w");
+        if (fp) {
+            // FB_BLANK_UNBLANK or FB_BLANK_POWERDOWN
+            done = fputs(on ? "0" : "4", fp) >= 0 ? 0 : -1;
+            if (0 != fclose(fp)) {
+                done = -1;
+            }
+        }
+        globfree(&gl);
+    }
+    return done;
+}
@@ -0,0 +1,140 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <stdlib.h>
+#include <SDL2/SDL.h>
+#include "quality_governor.h"
+#include "logging.h"
+#include "texture_cache.h"
+#include "vumeter_util.h"
+
+// frames per evaluation window
+#define QUALITY_WINDOW 60
+// degrade when more than 1 frame in 10 is this late, percent of the budget
+#define QUALITY_LATE_PERCENT 150
+#define QUALITY_LATE_FRAMES (QUALITY_WINDOW/10)
+// restore when the p95 render time is below this, percent of the budget
+#define QUALITY_HEADROOM_PERCENT 50
+// consecutive windows with headroom before restoring a level,
+// a longer wait after a level was dropped avoids oscillating
+#define QUALITY_RESTORE_WINDOWS 5
+#define QUALITY_RESTORE_HOLDOFF_WINDOWS 30
+
+static const char* level_names[QUALITY_LEVEL_COUNT] = {
+    "full",
+    "nearest_scale",
+    "no_off_segments",
+    "half_rate",
+};
+
+static int64_t budget;
+static quality_level level;
+static int64_t work_times[QUALITY_WINDOW];
+static unsigned samples;
+static unsigned late_frames;
+static unsigned headroom_windows;
+static unsigned holdoff_windows;
+static unsigned level_changes;
+static unsigned windows_at_level[QUALITY_LEVEL_COUNT];
+
+// SDL_ScaleModeBest is linear filtering on the GL, GLES2 and software
+// renderers, so there is no intermediate linear level.
+SDL_ScaleMode quality_governor_scale_mode(quality_level level) {
+    return level >= QUALITY_NEAREST_SCALE ? SDL_ScaleModeNearest : SDL_ScaleModeBest;
+}
+
+static void apply_level(quality_level next) {
+    perf_printf("quality: %s -> %s\n", level_names[level], level_names[next]);
+    tcache_set_scale_mode(quality_governor_scale_mode(next));
+    VUMeter_skip_off_segments(next >= QUALITY_NO_OFF_SEGMENTS);
+    level = next;
+    ++level_changes;
+}
+
+void quality_governor_init(int64_t period) {
+    budget = period;
+    level = QUALITY_FULL;
+    samples = 0;
+    late_frames = 0;
+    headroom_windows = 0;
+    holdoff_windows = 0;
+}
+
+void quality_governor_set_period(int64_t period) {
+    budget = period;
+}
+
+void quality_governor_shutdown(void) {
+    if (level != QUALITY_FULL) {
+        apply_level(QUALITY_FULL);
+    }
+}
+
+static int compare_int64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void evaluate_window(void) {
+    ++windows_at_level[level];
+    if (holdoff_windows) {
+        --holdoff_windows;
+    }
+    if (late_frames > QUALITY_LATE_FRAMES) {
+        headroom_windows = 0;
+        if (level + 1 < QUALITY_LEVEL_COUNT) {
+            apply_level(level + 1);
+            holdoff_windows = QUALITY_RESTORE_HOLDOFF_WINDOWS;
+        }
+        return;
+    }
+    qsort(work_times, QUALITY_WINDOW, sizeof(work_times[0]), compare_int64);
+    int64_t p95 = work_times[(QUALITY_WINDOW - 1) * 95 / 100];
+    // the next level up must fit a full rate budget
+    if (p95 * 100 < budget * QUALITY_HEADROOM_PERCENT && level != QUALITY_FULL) {
+        if (++headroom_windows >= QUALITY_RESTORE_WINDOWS && holdoff_windows == 0) {
+            apply_level(level - 1);
+            headroom_windows = 0;
+        }
+    } else {
+        headroom_windows = 0;
+    }
+}
+
+void quality_governor_frame(int64_t interval, int64_t work) {
+    // at half rate the loop still runs every period,
+    // skipped frames are not presented and are not recorded
+    if (interval * 100 > budget * QUALITY_LATE_PERCENT) {
+        ++late_frames;
+    }
+    work_times[samples++] = work;
+    if (samples == QUALITY_WINDOW) {
+        evaluate_window();
+        samples = 0;
+        late_frames = 0;
+    }
+}
+
+quality_level quality_governor_level(void) {
+    return level;
+}
+
+const char* quality_governor_level_name(quality_level lvl) {
+    return level_names[lvl];
+}
+
+bool quality_governor_skip_frame(unsigned n) {
+    return level == QUALITY_HALF_RATE && (n & 1);
+}
+
+void quality_governor_report(void (*printer)(char *format, ...)) {
+    printer("quality: level=%s changes=%u windows:", level_names[level], level_changes);
+    for (int ix = 0; ix < QUALITY_LEVEL_COUNT; ++ix) {
+        printer(" %s=%u", level_names[ix], windows_at_level[ix]);
+    }
+    printer("\n");
+}
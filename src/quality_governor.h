@@ -0,0 +1,38 @@
+#ifndef __jl_quality_governor_h_
+#define __jl_quality_governor_h_
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "types.h"
+
+// Rendering is degraded a level at a time while frames miss their
+// deadline, and restored a level at a time when there is headroom.
+typedef enum {
+    QUALITY_FULL,
+    // textures are scaled with nearest pixel sampling
+    QUALITY_NEAREST_SCALE,
+    // unlit (AGGREGATEOFF) VU meter segments are not drawn
+    QUALITY_NO_OFF_SEGMENTS,
+    // animated widgets are updated every other frame
+    QUALITY_HALF_RATE,
+    QUALITY_LEVEL_COUNT
+} quality_level;
+
+// render thread
+// period is the frame time budget in microseconds
+void quality_governor_init(int64_t period);
+void quality_governor_set_period(int64_t period);
+// restore full quality
+void quality_governor_shutdown(void);
+// Record a rendered frame: interval is the time since the previous frame
+// went out, work is the time spent rendering it.
+void quality_governor_frame(int64_t interval, int64_t work);
+quality_level quality_governor_level(void);
+// texture scaling at a level, layers baked at another level with the
+// same scaling need not be re-rendered
+SDL_ScaleMode quality_governor_scale_mode(quality_level level);
+const char* quality_governor_level_name(quality_level level);
+// whether animated widgets are skipped in frame number n
+bool quality_governor_skip_frame(unsigned n);
+void quality_governor_report(void (*printer)(char *format, ...));
+
+#endif // __jl_quality_governor_h_
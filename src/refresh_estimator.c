@@ -0,0 +1,99 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <stdlib.h>
+#include "refresh_estimator.h"
+#include "logging.h"
+
+// an interval of up to this many periods is a present that missed vblanks
+#define REFRESH_MAX_PERIODS 4
+// samples within this of the median are averaged, per mille
+#define REFRESH_TRIM_PER_MILLE 20
+// share of samples that must be within the trim for an estimate, percent
+#define REFRESH_STABLE_PERCENT 80
+
+void refresh_estimator_init(refresh_estimator* est, int64_t nominal) {
+    est->period = nominal;
+    est->nominal = nominal;
+    est->period_nsecs = nominal * 1000;
+    est->last_present = 0;
+    est->count = 0;
+    est->rejected = 0;
+    est->estimates = 0;
+}
+
+void refresh_estimator_break(refresh_estimator* est) {
+    est->last_present = 0;
+}
+
+double refresh_estimator_rate(const refresh_estimator* est) {
+    return est->period_nsecs > 0 ? 1e9 / est->period_nsecs : 0;
+}
+
+static int compare_int64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Mean of the samples near the median, scheduling noise and missed
+// vblanks do not shift it. Returns 0 if the samples are too scattered.
+static int64_t estimate(refresh_estimator* est) {
+    qsort(est->intervals, REFRESH_ESTIMATOR_SAMPLES, sizeof(est->intervals[0]), compare_int64);
+    int64_t median = est->intervals[REFRESH_ESTIMATOR_SAMPLES / 2];
+    int64_t trim = median * REFRESH_TRIM_PER_MILLE / 1000;
+    int64_t sum = 0;
+    unsigned n = 0;
+    for (unsigned ix = 0; ix < REFRESH_ESTIMATOR_SAMPLES; ++ix) {
+        if (llabs(est->intervals[ix] - median) <= trim) {
+            sum += est->intervals[ix];
+            ++n;
+        }
+    }
+    if (n * 100 < REFRESH_ESTIMATOR_SAMPLES * REFRESH_STABLE_PERCENT) {
+        perf_printf("refresh: %u of %u intervals near %ld nsecs, no estimate\n", n, REFRESH_ESTIMATOR_SAMPLES, median);
+        return 0;
+    }
+    return (sum + n / 2) / n;
+}
+
+bool refresh_estimator_present(refresh_estimator* est, int64_t timestamp) {
+    int64_t last = est->last_present;
+    est->last_present = timestamp;
+    if (last == 0) {
+        return false;
+    }
+    // a present that missed vblanks covers several periods
+    int64_t interval = (timestamp - last) * 1000;
+    int64_t periods = (interval + est->period_nsecs / 2) / est->period_nsecs;
+    if (periods < 1 || periods > REFRESH_MAX_PERIODS) {
+        ++est->rejected;
+        return false;
+    }
+    est->intervals[est->count++] = interval / periods;
+    if (est->count < REFRESH_ESTIMATOR_SAMPLES) {
+        return false;
+    }
+    est->count = 0;
+    int64_t period_nsecs = estimate(est);
+    if (period_nsecs == 0) {
+        return false;
+    }
+    ++est->estimates;
+    // small changes of the rate are noise
+    if (est->estimates > 1 && llabs(period_nsecs - est->period_nsecs) * 1000 <= est->period_nsecs) {
+        return false;
+    }
+    est->period_nsecs = period_nsecs;
+    int64_t period = (period_nsecs + 500) / 1000;
+    perf_printf("refresh: %.3f Hz, period %ld usecs, nominal %ld usecs, %u intervals rejected\n",
+            refresh_estimator_rate(est), period, est->nominal, est->rejected);
+    if (period == est->period) {
+        return false;
+    }
+    est->period = period;
+    return true;
+}
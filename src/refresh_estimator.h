@@ -0,0 +1,35 @@
+#ifndef __jl_refresh_estimator_h_
+#define __jl_refresh_estimator_h_
+#include <stdint.h>
+#include "types.h"
+
+// intervals in an estimate, 2 seconds at 60Hz
+#define REFRESH_ESTIMATOR_SAMPLES 120
+
+// Estimates the display refresh period from the times vsynced
+// presents return, the reported refresh rate is an integer and
+// may be missing.
+typedef struct {
+    // microseconds, the nominal period until an estimate is made
+    int64_t  period;
+    int64_t  nominal;
+    // nanoseconds, for a precise rate
+    int64_t  period_nsecs;
+    int64_t  last_present;
+    unsigned count;
+    unsigned rejected;
+    unsigned estimates;
+    // nanoseconds, a single period each
+    int64_t  intervals[REFRESH_ESTIMATOR_SAMPLES];
+} refresh_estimator;
+
+void refresh_estimator_init(refresh_estimator* est, int64_t nominal);
+// Record the time a vsynced present returned, returns true when
+// the estimated period changed.
+bool refresh_estimator_present(refresh_estimator* est, int64_t timestamp);
+// The next present does not follow a vsynced present.
+void refresh_estimator_break(refresh_estimator* est);
+// frames per second
+double refresh_estimator_rate(const refresh_estimator* est);
+
+#endif // __jl_refresh_estimator_h_
@@ -0,0 +1,112 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <math.h>
+#include "render_batch.h"
+#include "draw_stats.h"
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define RENDER_BATCH_GEOMETRY 1
+#endif
+
+// two triangles per quad, vertices are top left, top right,
+// bottom right, bottom left
+static int indices[RENDER_BATCH_QUADS * 6];
+
+void render_batch_begin(render_batch* batch, SDL_Renderer* renderer) {
+    if (indices[1] == 0) {
+        for (int q = 0; q < RENDER_BATCH_QUADS; ++q) {
+            int* ix = &indices[q * 6];
+            ix[0] = q * 4;
+            ix[1] = q * 4 + 1;
+            ix[2] = q * 4 + 2;
+            ix[3] = q * 4;
+            ix[4] = q * 4 + 2;
+            ix[5] = q * 4 + 3;
+        }
+    }
+    batch->renderer = renderer;
+    batch->texture = NULL;
+    batch->quads = 0;
+}
+
+void render_batch_flush(render_batch* batch) {
+    if (batch->quads) {
+#ifdef RENDER_BATCH_GEOMETRY
+        draw_geometry(batch->renderer, batch->texture,
+                batch->vertices, batch->quads * 4, indices, batch->quads * 6);
+#endif
+        batch->quads = 0;
+    }
+}
+
+void render_batch_release(void* context) {
+    render_batch* batch = context;
+    render_batch_flush(batch);
+    batch->texture = NULL;
+}
+
+void render_batch_copy_ex(render_batch* batch, SDL_Texture* texture,
+        const SDL_Rect* src_rect, const SDL_Rect* dst_rect,
+        double angle, const SDL_Point* centre) {
+    if (texture == NULL) {
+        return;
+    }
+#ifndef RENDER_BATCH_GEOMETRY
+    if (angle == 0) {
+        draw_copy(batch->renderer, texture, src_rect, dst_rect);
+    } else {
+        draw_copy_ex(batch->renderer, texture, src_rect, dst_rect, angle, centre, SDL_FLIP_NONE);
+    }
+#else
+    if (texture != batch->texture || batch->quads == RENDER_BATCH_QUADS) {
+        render_batch_flush(batch);
+        if (texture != batch->texture) {
+            batch->texture = texture;
+            SDL_QueryTexture(texture, NULL, NULL, &batch->tex_w, &batch->tex_h);
+        }
+    }
+    draw_stats_copy(batch->renderer, texture, src_rect, dst_rect, angle);
+
+    float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+    if (src_rect) {
+        u0 = (float)src_rect->x / batch->tex_w;
+        v0 = (float)src_rect->y / batch->tex_h;
+        u1 = (float)(src_rect->x + src_rect->w) / batch->tex_w;
+        v1 = (float)(src_rect->y + src_rect->h) / batch->tex_h;
+    }
+
+    float cx = dst_rect->x + (centre ? centre->x : dst_rect->w / 2.0f);
+    float cy = dst_rect->y + (centre ? centre->y : dst_rect->h / 2.0f);
+    // corners relative to the centre of rotation
+    float left = dst_rect->x - cx;
+    float top = dst_rect->y - cy;
+    float right = left + dst_rect->w;
+    float bottom = top + dst_rect->h;
+    const float xs[4] = {left, right, right, left};
+    const float ys[4] = {top, top, bottom, bottom};
+    const float us[4] = {u0, u1, u1, u0};
+    const float vs[4] = {v0, v0, v1, v1};
+
+    float s = 0, c = 1;
+    if (angle != 0) {
+        double rad = angle * M_PI / 180.0;
+        s = (float)sin(rad);
+        c = (float)cos(rad);
+    }
+
+    SDL_Vertex* vx = &batch->vertices[batch->quads * 4];
+    for (int ix = 0; ix < 4; ++ix, ++vx) {
+        vx->position.x = cx + xs[ix] * c - ys[ix] * s;
+        vx->position.y = cy + xs[ix] * s + ys[ix] * c;
+        // element textures do not use colour or alpha modulation
+        vx->color.r = vx->color.g = vx->color.b = vx->color.a = 255;
+        vx->tex_coord.x = us[ix];
+        vx->tex_coord.y = vs[ix];
+    }
+    ++batch->quads;
+#endif
+}
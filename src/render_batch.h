@@ -0,0 +1,35 @@
+#ifndef __jl_render_batch_h_
+#define __jl_render_batch_h_
+#include <SDL2/SDL.h>
+
+// Textured quads are gathered and submitted with one SDL_RenderGeometry
+// call per run of quads using the same texture. Runs preserve the draw
+// order, so overlapping elements render as they would with RenderCopyEx.
+
+#define RENDER_BATCH_QUADS 256
+
+typedef struct {
+    SDL_Renderer* renderer;
+    SDL_Texture*  texture;
+    int           quads;
+    int           tex_w;
+    int           tex_h;
+    SDL_Vertex    vertices[RENDER_BATCH_QUADS * 4];
+} render_batch;
+
+// render thread
+void render_batch_begin(render_batch* batch, SDL_Renderer* renderer);
+// Same arguments and semantics as SDL_RenderCopyEx without flipping,
+// angle is in degrees clockwise, centre is relative to dst_rect,
+// NULL centre => the centre of dst_rect, NULL src_rect => the whole texture.
+void render_batch_copy_ex(render_batch* batch, SDL_Texture* texture,
+        const SDL_Rect* src_rect, const SDL_Rect* dst_rect,
+        double angle, const SDL_Point* centre);
+// Submit pending quads, call before any other rendering
+// and at the end of the batch.
+void render_batch_flush(render_batch* batch);
+// Submit pending quads and forget the current texture, the texture cache
+// release hook while batching, textures may be destroyed or reused after it.
+void render_batch_release(void* batch);
+
+#endif // __jl_render_batch_h_
@@ -0,0 +1,221 @@
+/*
+** Copyright 2025 Blaise Dias. All Rights Reserved.
+**
+** This file is licensed under BSD. Please see the LICENSE file for details.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "render_select.h"
+#include "logging.h"
+#include "timing.h"
+
+// one line per display: <key>\t<driver name>
+#define RENDER_SELECT_CACHE_PATH "./.sqvumeter_render_driver"
+#define RENDER_SELECT_WARMUP_FRAMES 20
+#define RENDER_SELECT_FRAMES 200
+// sprite copies per frame, about the element count of a bar meter
+#define RENDER_SELECT_SPRITES 98
+#define RENDER_SELECT_SPRITE_DIM 64
+
+static int driver_index(const char* name) {
+    for (int ix = 0; ix < SDL_GetNumRenderDrivers(); ++ix) {
+        SDL_RendererInfo info;
+        if (0 == SDL_GetRenderDriverInfo(ix, &info) && 0 == strcmp(info.name, name)) {
+            return ix;
+        }
+    }
+    return -1;
+}
+
+// The choice is only valid for the same video driver, display mode
+// and set of render drivers.
+static void display_key(SDL_Window* window, char* key, size_t size) {
+    SDL_DisplayMode mode = {0};
+    SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode);
+    int len = snprintf(key, size, "%s:%dx%d@%d:", SDL_GetCurrentVideoDriver(), mode.w, mode.h, mode.refresh_rate);
+    for (int ix = 0; ix < SDL_GetNumRenderDrivers() && len < (int)size; ++ix) {
+        SDL_RendererInfo info;
+        if (0 == SDL_GetRenderDriverInfo(ix, &info)) {
+            len += snprintf(key + len, size - len, "%s%s", ix ? "," : "", info.name);
+        }
+    }
+}
+
+static bool read_cached(const char* key, char* name, size_t size) {
+    FILE* fp = fopen(RENDER_SELECT_CACHE_PATH, "r");
+    if (fp == NULL) {
+        return false;
+    }
+    bool found = false;
+    char line[512];
+    while (!found && fgets(line, sizeof(line), fp)) {
+        char* tab = strchr(line, '\t');
+        if (tab) {
+            *tab = '\0';
+            if (0 == strcmp(line, key)) {
+                tab[strcspn(tab + 1, "\r\n") + 1] = '\0';
+                snprintf(name, size, "%s", tab + 1);
+                found = true;
+            }
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+// replace the entry for key, entries for other displays are kept
+static void write_cached(const char* key, const char* name) {
+    char lines[16][512];
+    int count = 0;
+    FILE* fp = fopen(RENDER_SELECT_CACHE_PATH, "r");
+    if (fp) {
+        size_t key_len = strlen(key);
+        while (count < 16 && fgets(lines[count], sizeof(lines[0]), fp)) {
+            if (!(0 == strncmp(lines[count], key, key_len) && lines[count][key_len] == '\t')) {
+                ++count;
+            }
+        }
+        fclose(fp);
+    }
+    fp = fopen(RENDER_SELECT_CACHE_PATH, "w");
+    if (fp == NULL) {
+        error_printf("render_select: failed to write %s\n", RENDER_SELECT_CACHE_PATH);
+        return;
+    }
+    for (int ix = 0; ix < count; ++ix) {
+        fputs(lines[ix], fp);
+    }
+    fprintf(fp, "%s\t%s\n", key, name);
+    fclose(fp);
+}
+
+static SDL_Texture* create_texture(SDL_Renderer* renderer, int w, int h, bool sprite) {
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (surface == NULL) {
+        return NULL;
+    }
+    for (int y = 0; y < h; ++y) {
+        Uint32* row = (Uint32*)((Uint8*)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < w; ++x) {
+            // sprites have a translucent edge, the background is opaque
+            Uint32 alpha = sprite ? (Uint32)(255 * (x < y ? x : y) / (w > 1 ? w - 1 : 1)) : 255;
+            row[x] = alpha << 24 | (Uint32)(x * 255 / w) << 16 | (Uint32)(y * 255 / h) << 8 | 0x40;
+        }
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (texture) {
+        SDL_SetTextureBlendMode(texture, sprite ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+    }
+    return texture;
+}
+
+static int compare_int64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Median frame time of a workload shaped like a VU meter frame:
+// an opaque full screen background, a row of scaled translucent
+// segments and a rotated needle. Returns -1 if the driver is unusable.
+static int64_t time_driver(SDL_Window* window, int index) {
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, index, 0);
+    if (renderer == NULL) {
+        return -1;
+    }
+    int w, h;
+    SDL_GetRendererOutputSize(renderer, &w, &h);
+    SDL_Texture* background = create_texture(renderer, w, h, false);
+    SDL_Texture* sprite = create_texture(renderer, RENDER_SELECT_SPRITE_DIM, RENDER_SELECT_SPRITE_DIM, true);
+    static int64_t frame_usecs[RENDER_SELECT_FRAMES];
+    int64_t result = -1;
+    if (background && sprite) {
+        SDL_Rect seg = {.w = w / (RENDER_SELECT_SPRITES / 2), .h = h / 4};
+        SDL_Rect needle = {.x = w / 2 - w / 64, .y = h / 8, .w = w / 32, .h = h / 2};
+        Uint32 pixel;
+        SDL_Rect probe = {0, 0, 1, 1};
+        for (int frame = 0; frame < RENDER_SELECT_WARMUP_FRAMES + RENDER_SELECT_FRAMES; ++frame) {
+            int64_t t0 = get_micro_seconds();
+            SDL_RenderClear(renderer);
+            SDL_RenderCopy(renderer, background, NULL, NULL);
+            for (int ix = 0; ix < RENDER_SELECT_SPRITES; ++ix) {
+                seg.x = (ix % (RENDER_SELECT_SPRITES / 2)) * seg.w;
+                seg.y = ix < RENDER_SELECT_SPRITES / 2 ? h / 8 : h * 5 / 8;
+                SDL_RenderCopy(renderer, sprite, NULL, &seg);
+            }
+            SDL_RenderCopyEx(renderer, sprite, NULL, &needle, (frame % 90) - 45.0, NULL, SDL_FLIP_NONE);
+            // reading back a pixel waits for the GPU to finish the frame
+            SDL_RenderReadPixels(renderer, &probe, SDL_PIXELFORMAT_ARGB8888, &pixel, sizeof(pixel));
+            SDL_RenderPresent(renderer);
+            if (frame >= RENDER_SELECT_WARMUP_FRAMES) {
+                frame_usecs[frame - RENDER_SELECT_WARMUP_FRAMES] = get_micro_seconds() - t0;
+            }
+        }
+        qsort(frame_usecs, RENDER_SELECT_FRAMES, sizeof(frame_usecs[0]), compare_int64);
+        result = frame_usecs[RENDER_SELECT_FRAMES / 2];
+    }
+    if (sprite) {
+        SDL_DestroyTexture(sprite);
+    }
+    if (background) {
+        SDL_DestroyTexture(background);
+    }
+    SDL_DestroyRenderer(renderer);
+    return result;
+}
+
+static int calibrate(SDL_Window* window, const char* key) {
+    int best = -1;
+    int64_t best_usecs = 0;
+    for (int ix = 0; ix < SDL_GetNumRenderDrivers(); ++ix) {
+        SDL_RendererInfo info;
+        if (SDL_GetRenderDriverInfo(ix, &info)) {
+            continue;
+        }
+        int64_t usecs = time_driver(window, ix);
+        if (usecs < 0) {
+            printf("render driver %-12s unavailable %s\n", info.name, SDL_GetError());
+            SDL_ClearError();
+            continue;
+        }
+        printf("render driver %-12s median frame %6ld usecs\n", info.name, usecs);
+        if (best < 0 || usecs < best_usecs) {
+            best = ix;
+            best_usecs = usecs;
+        }
+    }
+    if (best >= 0) {
+        SDL_RendererInfo info;
+        SDL_GetRenderDriverInfo(best, &info);
+        printf("render driver %s selected\n", info.name);
+        write_cached(key, info.name);
+    }
+    return best;
+}
+
+int render_select_driver(SDL_Window* window, const char* name, bool calibrate_drivers) {
+    if (name) {
+        int index = driver_index(name);
+        if (index < 0) {
+            error_printf("render driver %s is not available\n", name);
+        }
+        return index;
+    }
+    char key[256];
+    display_key(window, key, sizeof(key));
+    if (calibrate_drivers) {
+        return calibrate(window, key);
+    }
+    char cached[64];
+    if (read_cached(key, cached, sizeof(cached))) {
+        int index = driver_index(cached);
+        if (index >= 0) {
+            printf("render driver %s from %s\n", cached, RENDER_SELECT_CACHE_PATH);
+        }
+        return index;
+    }
+    return -1;
+}
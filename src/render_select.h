@@ -0,0 +1,14 @@
+#ifndef __jl_render_select_h_
+#define __jl_render_select_h_
+#include <SDL2/SDL.h>
+#include "types.h"
+
+// Choose the SDL render driver index for the window.
+//  name: driver name from the command line, overrides everything else
+//  calibrate: time a short rendering workload on every driver, and cache
+//      the fastest for this display
+// Otherwise the cached choice for this display is used.
+// Returns -1 to let SDL choose.
+int render_select_driver(SDL_Window* window, const char* name, bool calibrate);
+
+#endif // __jl_render_select_h_
@@ -0,0 +1,42 @@
+#ifndef __jl_seqlock_h_
+#define __jl_seqlock_h_
+#include <stdint.h>
+#include "types.h"
+
+// Sequence lock, publishes a small block of state from writer threads to
+// readers which never block the writers. The sequence is odd while a write
+// is in progress, a reader retries or gives up if it changed.
+typedef struct {
+    uint32_t atomic_seq;
+} seqlock;
+
+// Writers, any thread. Concurrent writers are serialised by spinning,
+// keep the write section short.
+static inline void seqlock_write_begin(seqlock* lock) {
+    uint32_t seq = __atomic_load_n(&lock->atomic_seq, __ATOMIC_RELAXED);
+    do {
+        while (seq & 1) {
+            seq = __atomic_load_n(&lock->atomic_seq, __ATOMIC_RELAXED);
+        }
+    } while (!__atomic_compare_exchange_n(&lock->atomic_seq, &seq, seq + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+    // the state stores must not become visible before the odd sequence
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seqlock_write_end(seqlock* lock) {
+    __atomic_store_n(&lock->atomic_seq, __atomic_load_n(&lock->atomic_seq, __ATOMIC_RELAXED) + 1, __ATOMIC_RELEASE);
+}
+
+// Readers. Returns false if a write is in progress.
+static inline bool seqlock_read_try(const seqlock* lock, uint32_t* seq) {
+    *seq = __atomic_load_n(&lock->atomic_seq, __ATOMIC_ACQUIRE);
+    return (*seq & 1) == 0;
+}
+
+// Whether the state read since seqlock_read_try may be torn.
+static inline bool seqlock_read_retry(const seqlock* lock, uint32_t seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&lock->atomic_seq, __ATOMIC_RELAXED) != seq;
+}
+
+#endif // __jl_seqlock_h_
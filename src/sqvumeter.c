@@ -20,6 +20,13 @@ const char* help_text=""
 " - [help, -h, --h] : print this text and exit\n"
 "\n"  
 " - vsync : use vertical sync when rendering each frame\n"
+" - fullredraw : redraw all widgets every frame, by default only changed regions are redrawn\n"
+" - fixedquality : do not reduce rendering quality when frames are late\n"
+" - rotatescene : with rotation, render unrotated and rotate the whole scene once per frame\n"
+" - softcompositor : draw into the window surface with the software renderer, updating only changed regions\n"
+" - render_driver <name> : use the named SDL render driver, e.g. opengles2, opengl, software\n"
+" - calibrate_renderer : time each render driver and remember the fastest for this display\n"
+" - render_scale <scale> : render at a lower resolution and upscale once per frame, 0.25 to 1.0. Default is 1.0\n"
 " - max_secs <count> : time to run before terminating, infinite if not specified\n"
 " - cycle <count> : number of seconds before cycling to the next the VU Meter\n"
 " - [0.0, 90.0, 180.0, 270.0] : rotation. Default is 0.0\n"
@@ -33,6 +40,8 @@ const char* help_text=""
 " - profile      enable printing of render loop performance metrics (per frame)\n"
 " - profile_fps_deviation      enable printing of render loop performance metrics (per frame) when fps has deviated\n"
 " - profile_texture   enable printing of render loop texture metrics\n"
+"                 key 'p' or SIGUSR1 prints frame phase percentiles and writes\n"
+"                 the recent frames to /tmp/sqvumeter-trace-<pid>-<n>.json (chrome://tracing)\n"
 " - printfjson   enable printing of json processing\n"
 " - printfaction enable printing of actions\n"
 " - printftcache enable printing of texture cache module\n"
@@ -55,8 +64,18 @@ const char* help_text=""
 " - decayhold <count>: number of frames for VU decay hold - reduces needle jitter\n"
 "\n"
 " - texture_cache_size <count>: maximum number of texture bytes\n"
+" - texture_cache_size auto: limit texture bytes to the estimated working set,\n"
+"                            capped by the texture memory the renderer can allocate\n"
 "\n"
 " - lms <name>: lyrion media server network name or ip address \n"
+"\n"
+" - bench <count>: headless benchmark, render count frames per VU meter with the dummy\n"
+"                  video driver and the software renderer, with synthetic levels\n"
+" - bench_json <path>: write benchmark results to path instead of stdout\n"
+"\n"
+" - idle_secs <count>: seconds of silence, pause or stop before reducing the frame rate, 0 disables. Default is 10\n"
+" - idle_fps <count>: frame rate when idle, 0 renders only when widgets change. Default is 0\n"
+" - blank_secs <count>: seconds of pause or stop before blanking the screen, 0 disables. Default is 0\n"
 "\n";  
 
 const char* json_file="./npvu.json";
@@ -74,14 +93,21 @@ extern void player_poll_loop(view_context* view);
 int main(int argc, char **argv) {
     struct App app = {
         .context = {
+            .start_usecs = get_micro_seconds(),
             .renderer = NULL,
             .window = NULL,
             .max_secs = 0,
             .cycle_secs = 0,
             .vsync = 0,
+            .render_scale = 1.0,
             .window_title = WINDOW_TITLE,
             .json_file = json_file,
             .dump_vu = false,
+            .governor = {
+                .idle_fps = 0,
+                .idle_secs = 10,
+                .blank_secs = 0,
+            },
         },
 //        .keystate = SDL_GetKeyboardState(NULL),
     };
@@ -111,6 +137,30 @@ int main(int argc, char **argv) {
             }
         } else if (0 == strcmp(argv[i], "vsync")) {
             app.context.vsync = 1;
+        } else if (0 == strcmp(argv[i], "fullredraw")) {
+            app.context.full_redraw = true;
+        } else if (0 == strcmp(argv[i], "fixedquality")) {
+            app.context.fixed_quality = true;
+        } else if (0 == strcmp(argv[i], "rotatescene")) {
+            app.context.rotate_scene = true;
+        } else if (0 == strcmp(argv[i], "softcompositor")) {
+            app.context.soft_compositor = true;
+        } else if (0 == strcmp(argv[i], "render_driver")) {
+            if (argc > i+1) {
+                app.context.render_driver = argv[i+1];
+                i += 1;
+            }
+        } else if (0 == strcmp(argv[i], "calibrate_renderer")) {
+            app.context.calibrate_renderer = true;
+        } else if (0 == strcmp(argv[i], "render_scale")) {
+            if (argc > i+1) {
+                app.context.render_scale = atof(argv[i+1]);
+                if (app.context.render_scale < 0.25 || app.context.render_scale > 1.0) {
+                    error_printf("render_scale %s is out of range, using 1.0\n", argv[i+1]);
+                    app.context.render_scale = 1.0;
+                }
+                i += 1;
+            }
         } else if (0 == strcmp(argv[i], "dumpvu")) {
             app.context.dump_vu = true;
         } else if (0 == strcmp(argv[i], "0.0")) {
@@ -200,7 +250,36 @@ int main(int argc, char **argv) {
             }
         } else if (0 == strcmp(argv[i], "texture_cache_size")) {
             if (argc > i+1) {
-                tcache_set_limit(atoi(argv[i+1]));
+                if (0 == strcmp(argv[i+1], "auto")) {
+                    tcache_set_auto_limit();
+                } else {
+                    tcache_set_limit(atoi(argv[i+1]));
+                }
+                i += 1;
+            }
+        } else if (0 == strcmp(argv[i], "idle_secs")) {
+            if (argc > i+1) {
+                app.context.governor.idle_secs = atoi(argv[i+1]);
+                i += 1;
+            }
+        } else if (0 == strcmp(argv[i], "idle_fps")) {
+            if (argc > i+1) {
+                app.context.governor.idle_fps = atoi(argv[i+1]);
+                i += 1;
+            }
+        } else if (0 == strcmp(argv[i], "blank_secs")) {
+            if (argc > i+1) {
+                app.context.governor.blank_secs = atoi(argv[i+1]);
+                i += 1;
+            }
+        } else if (0 == strcmp(argv[i], "bench")) {
+            if (argc > i+1) {
+                app.context.bench_frames = atoi(argv[i+1]);
+                i += 1;
+            }
+        } else if (0 == strcmp(argv[i], "bench_json")) {
+            if (argc > i+1) {
+                app.context.bench_json = argv[i+1];
                 i += 1;
             }
         } else if (0 == strcmp(argv[i], "lms")) {
@@ -225,6 +304,17 @@ int main(int argc, char **argv) {
         app.context.screen_height = 480;
     }
 
+    if (app.context.bench_frames > 0) {
+        // deterministic and headless: no display, player or input
+        setenv("SDL_VIDEODRIVER", "dummy", 1);
+        SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+        app.context.vsync = 0;
+        app.context.fullscreen = false;
+        SDL_Thread* render_thread = SDL_CreateThread((SDL_ThreadFunction)sdl_render_loop, "render", &view);
+        SDL_WaitThread(render_thread, NULL);
+        app_cleanup(&app.context, EXIT_SUCCESS);
+    }
+
     // TODO: move the following sections of code to application.c
     SDL_Thread* render_thread = SDL_CreateThread((SDL_ThreadFunction)sdl_render_loop, "render", &view);
     SDL_Thread* input_thread = SDL_CreateThread((SDL_ThreadFunction)sdl_input_loop, "input", &view);
@@ -911,7 +911,7 @@ int main(int argc, const char** argv) {
         for(int ix=0; ix < num_images; ++ix) {
             texture_id_t texture_id;
             const SDL_Texture *texture1, *texture2;
-            texture1 = tcache_quick_get_texture(ids[ix], renderer);
+            texture1 = tcache_quick_get_texture(ids[ix], renderer, NULL, NULL);
             sprintf(path_buff, "%s/%s", argv[1], pngs[ix]);
             texture2 = tcache_get_texture(path_buff, &texture_id, renderer);
             if (texture1 != texture2) {
@@ -977,7 +977,7 @@ int main(int argc, const char** argv) {
             if (surface_loaded[ix]) {
                 const SDL_Texture *texture2;
                 if (tcache_test_lru_eject() ) {
-                    texture2 = tcache_quick_get_texture(ids[ix], renderer);
+                    texture2 = tcache_quick_get_texture(ids[ix], renderer, NULL, NULL);
                     if (texture2) {
                         printf("FAIL: %d) texture LRU eject failed id=%d %p\n", ix, ids[ix], texture2);
                         exit(EXIT_FAILURE);
@@ -1054,7 +1054,7 @@ int main(int argc, const char** argv) {
             if(ix%2 != 0 && surface_loaded[ix]) {
                 const SDL_Texture *texture2;
                 if (tcache_test_lru_eject() ) {
-                    texture2 = tcache_quick_get_texture(ids[ix], renderer);
+                    texture2 = tcache_quick_get_texture(ids[ix], renderer, NULL, NULL);
                     if (texture2) {
                         printf("FAIL: %d) texture LRU eject failed id=%d %p\n", ix, ids[ix], texture2);
                         exit(EXIT_FAILURE);
@@ -1075,7 +1075,7 @@ int main(int argc, const char** argv) {
                 const SDL_Texture *texture2;
                 if (tcache_test_lru_eject() ) {
                     printf("FAIL: %d) texture LRU was ejected? \n", ix);
-                    texture2 = tcache_quick_get_texture(ids[ix], renderer);
+                    texture2 = tcache_quick_get_texture(ids[ix], renderer, NULL, NULL);
                     if (NULL == texture2) {
                         printf("FAIL: %d) texture LRU eject on locked image failed id=%d %p\n", ix, ids[ix], texture2);
                     }
@@ -1090,6 +1090,39 @@ int main(int argc, const char** argv) {
         endoftest();
     }
 
+    {
+        startoftest("mip level selection");
+        int mip_count = 0;
+        for(int ix=0; ix < num_images; ++ix) {
+            if(ix%2 == 0 && surface_loaded[ix]) {
+                int w = 0, h = 0;
+                tcache_quick_get_texture_dimensions(ids[ix], &w, &h);
+                SDL_Texture* full = tcache_quick_get_texture(ids[ix], renderer, NULL, NULL);
+                SDL_Rect dst = {.x=0, .y=0, .w=w/4, .h=h/4};
+                SDL_Texture* quarter = tcache_quick_get_texture(ids[ix], renderer, &dst, NULL);
+                int qw = 0, qh = 0;
+                if (quarter == NULL || SDL_QueryTexture(quarter, NULL, NULL, &qw, &qh)) {
+                    printf("FAIL: %d) no texture for %dx%d id=%d\n", ix, dst.w, dst.h, ids[ix]);
+                    exit(EXIT_FAILURE);
+                }
+                // a level must never be smaller than the destination
+                if (qw < dst.w || qh < dst.h) {
+                    printf("FAIL: %d) level %dx%d smaller than destination %dx%d id=%d\n", ix, qw, qh, dst.w, dst.h, ids[ix]);
+                    exit(EXIT_FAILURE);
+                }
+                if (quarter != full) {
+                    if (qw >= w || qh >= h) {
+                        printf("FAIL: %d) level %dx%d not smaller than %dx%d id=%d\n", ix, qw, qh, w, h, ids[ix]);
+                        exit(EXIT_FAILURE);
+                    }
+                    ++mip_count;
+                }
+            }
+        }
+        printf("textures drawn from downscaled levels = %d\n", mip_count);
+        endoftest();
+    }
+
     puts("SUCCESS");
 }
 
@@ -4,7 +4,10 @@
 ** This file is licensed under BSD. Please see the LICENSE file for details.
 */
 
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -20,6 +23,20 @@
 
 typedef struct tcache_entry tcache_entry;
 
+// Downscaled levels of images loaded from file, level n is 1/(2^n) the size
+// of the full size texture. Levels are generated when the image is decoded,
+// textures are created on demand when a level is selected for drawing.
+#define TCACHE_MAX_MIP_LEVELS 4
+// levels are not generated with a width or height smaller than this
+#define TCACHE_MIP_MIN_DIM 32
+
+typedef struct {
+    const SDL_Texture*  texture;
+    SDL_Surface*        surface;
+    int                 w,h;
+    int                 num_bytes;
+} tcache_mip;
+
 struct tcache_entry {
     uint32_t            lru_count;
     const char*         path;
@@ -30,7 +47,38 @@ struct tcache_entry {
     int                 num_bytes;
     bool                ejected;
     bool                locked;
-    bool                delete;
+    // tce_state: deletion state
+    uint8_t             delete;
+    int                 num_mips;
+    // mips[0] is level 1 (half size)
+    tcache_mip          mips[TCACHE_MAX_MIP_LEVELS];
+    // texture bytes for the entry when last resident, used to estimate
+    // the working set including ejected entries.
+    unsigned            ws_bytes;
+    // sprites are trimmed to the bounding box of pixels which are not
+    // fully transparent when decoded, trim_rect is the bounding box in
+    // the full size image of full_w x full_h pixels.
+    bool                trim;
+    // published with a release store after trim_rect and full_w/h
+    bool                trimmed;
+    // set while a thread decodes the image for the entry
+    bool                loading;
+    // every pixel is fully opaque, textures are drawn without blending
+    bool                opaque;
+    SDL_Rect            trim_rect;
+    int                 full_w, full_h;
+    // deleted entries waiting to be freed
+    tcache_entry*       retired_next;
+    uint64_t            retire_epoch;
+};
+
+// Deletion is requested by any thread, and performed by the render thread.
+// A request is cancelled if the entry is created or loaded again before
+// the render thread starts deleting it.
+enum tce_state {
+    TCE_LIVE = 0,
+    TCE_DELETE_REQUESTED,
+    TCE_DELETING,
 };
 
 static tcache_entry empty_tce = {
@@ -65,6 +113,27 @@ unsigned max_num_texture_bytes = 0;
 unsigned char delete_requested = 0;
 unsigned num_surface_bytes = 0;
 
+// Adaptive texture cache limit:
+// - alloc_ceiling is the texture memory the renderer can allocate,
+//   from a startup probe or learnt from allocation failures.
+// - the limit follows the working set, the bytes of textures used within
+//   a window of frames derived from the reuse distance of textures.
+#define TCACHE_WS_INTERVAL 64
+#define TCACHE_WS_MIN_BYTES (8*1024*1024)
+#define TCACHE_REUSE_BUCKETS 32
+#define TCACHE_ALLOC_RETRIES 8
+static bool auto_limit = false;
+// filtering of scaled textures, lowered by the quality governor
+static SDL_ScaleMode scale_mode = SDL_ScaleModeBest;
+static unsigned alloc_ceiling = 0;
+static unsigned working_set_bytes = 0;
+// textures created outside the cache, such as render targets
+static unsigned num_external_bytes = 0;
+static uint32_t working_set_window = 0;
+// histogram of reuse distances in frames, log2 buckets,
+// only reuse after at least one frame without use is counted.
+static unsigned reuse_hist[TCACHE_REUSE_BUCKETS];
+
 #define PRIME2K 2039
 #define PRIME4k 4093
 #define PRIME8k 8191
@@ -81,42 +150,105 @@ unsigned num_surface_bytes = 0;
 #define EMPTY_TEXTURE_ID HASHTPRIME
 static tcache_entry* tbl[NUM_TBL_ENTRIES];
 
-static SDL_threadID renderer_tid;
-
-static SDL_threadID delete_lock = 0;
+// least recently used order of entries with textures, set up every frame
+static struct {
+    tcache_entry* tbl[HASHTPRIME];
+    int count;
+    int ix;
+} lru_eject;
 
-// try acquire the spin lock, returns true if the lock was acquired,
-// false otherwise.
-static bool tcache_lock_try(SDL_threadID* ptr) {
-    SDL_threadID expected = 0;
-    SDL_threadID desired = SDL_GetThreadID(NULL);
-    return __atomic_compare_exchange (ptr, &expected, &desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
-}
+static SDL_threadID renderer_tid;
 
-// lock implementation using atomic compare and exchange
-// The thread trying to acquire the lock "spins",
-// sleeping for 1 millisecond and trying again.
-static void tcache_lock(SDL_threadID* ptr) {
-    while (!tcache_lock_try(ptr)) {
-        if (*ptr == SDL_GetThreadID(NULL)) {
-            error_printf("recursive locking is unsupported\n");
-            // bug: state is uncertain terminate execution immediately
+// Epoch based reclamation of table entries.
+// Threads other than the render thread access entries within an epoch
+// critical section, recording the global epoch on entry.
+// The render thread deletes an entry by replacing the table pointer,
+// then retires it with the current epoch and advances the epoch.
+// A retired entry is freed once every thread in a critical section
+// entered after it was retired, at which point no thread can hold a
+// pointer to it.
+// Entries are only deleted by the render thread, so the render thread
+// does not require a critical section to access entries.
+#define TCACHE_MAX_READERS 32
+
+static uint64_t global_epoch = 1;
+static struct {
+    SDL_threadID    tid;
+    // epoch at entry to the critical section, 0 if not in one.
+    uint64_t        epoch;
+} readers[TCACHE_MAX_READERS];
+static __thread int reader_slot = -1;
+static __thread int reader_depth = 0;
+// render thread only
+static tcache_entry* retired_list = NULL;
+static unsigned retired_count = 0;
+
+static void epoch_enter(void) {
+    if (reader_depth++) {
+        return;
+    }
+    if (reader_slot < 0) {
+        SDL_threadID tid = SDL_GetThreadID(NULL);
+        for(int ix=0; ix < TCACHE_MAX_READERS && reader_slot < 0; ++ix) {
+            SDL_threadID expected = 0;
+            if (__atomic_compare_exchange_n(&readers[ix].tid, &expected, tid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                reader_slot = ix;
+            }
+        }
+        if (reader_slot < 0) {
+            error_printf("epoch_enter: too many threads using the texture cache\n");
             exit(EXIT_FAILURE);
         }
-        sleep_milli_seconds(1);
     }
+    __atomic_store_n(&readers[reader_slot].epoch, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
 }
 
-// release previously acquired spin lock.
-static void tcache_unlock(SDL_threadID* ptr) {
-    SDL_threadID expected = SDL_GetThreadID(NULL);
-    SDL_threadID desired = 0;
-    if (__atomic_compare_exchange (ptr, &expected, &desired, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+static void epoch_exit(void) {
+    if (--reader_depth) {
         return;
     }
-    error_printf("tcache_unlock: invoked by thread not holding the lock\n");
-    // bug: state is uncertain terminate execution immediately
-    exit(EXIT_FAILURE);
+    __atomic_store_n(&readers[reader_slot].epoch, 0, __ATOMIC_RELEASE);
+}
+
+// Release the reader slot of the calling thread, threads which use the
+// texture cache and exit call this before exiting.
+void tcache_thread_exit(void) {
+    if (reader_slot >= 0 && reader_depth == 0) {
+        __atomic_store_n(&readers[reader_slot].tid, 0, __ATOMIC_RELEASE);
+        reader_slot = -1;
+    }
+}
+
+static void retire_tce(tcache_entry* tce) {
+    tce->retire_epoch = __atomic_fetch_add(&global_epoch, 1, __ATOMIC_SEQ_CST);
+    tce->retired_next = retired_list;
+    retired_list = tce;
+    ++retired_count;
+}
+
+static void free_tce(tcache_entry* tce);
+
+// Free retired entries which no thread can be accessing,
+// if force is true free all retired entries.
+static void reclaim_retired(bool force) {
+    uint64_t min_epoch = UINT64_MAX;
+    for(int ix=0; ix < TCACHE_MAX_READERS && !force; ++ix) {
+        uint64_t epoch = __atomic_load_n(&readers[ix].epoch, __ATOMIC_SEQ_CST);
+        if (epoch && epoch < min_epoch) {
+            min_epoch = epoch;
+        }
+    }
+    tcache_entry** pp = &retired_list;
+    while (*pp) {
+        tcache_entry* tce = *pp;
+        if (force || tce->retire_epoch < min_epoch) {
+            *pp = tce->retired_next;
+            free_tce(tce);
+            --retired_count;
+        } else {
+            pp = &tce->retired_next;
+        }
+    }
 }
 
 void tcache_set_renderer_tid(const SDL_threadID tid) {
@@ -200,15 +332,297 @@ static uint32_t hashfn(const char* token) {
 //    }
 //}
 
+// Pool of released textures, reused for uploads of surfaces with matching
+// dimensions and format, using SDL_UpdateTexture instead of creating a new
+// texture. Only accessed in the render thread.
+// Pooled textures count against the texture cache limit, the pool is drained
+// before textures in use are ejected.
+#define TCACHE_POOL_SIZE 64
+
+static struct {
+    SDL_Texture*    texture;
+    int             w,h;
+    Uint32          format;
+    int             access;
+    int             num_bytes;
+    uint32_t        seq;
+} pool[TCACHE_POOL_SIZE];
+static unsigned num_pool_bytes = 0;
+static uint32_t pool_seq = 0;
+static tcache_pool_stats pool_stats;
+
+static void pool_destroy(int ix) {
+    SDL_DestroyTexture(pool[ix].texture);
+    num_pool_bytes -= pool[ix].num_bytes;
+    pool[ix].texture = NULL;
+    pool[ix].num_bytes = 0;
+    ++pool_stats.destroyed;
+}
+
+// Destroy pooled textures, oldest first, until the pool and the cache
+// fit within limit bytes.
+static void pool_trim(unsigned limit) {
+    while (num_pool_bytes && num_texture_bytes + num_pool_bytes > limit) {
+        int oldest = -1;
+        for(int ix=0; ix < TCACHE_POOL_SIZE; ++ix) {
+            if (pool[ix].texture && (oldest < 0 || pool[ix].seq < pool[oldest].seq)) {
+                oldest = ix;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+        pool_destroy(oldest);
+    }
+}
+
+// Take ownership of a released texture, destroys the texture if it
+// cannot be pooled within the texture cache limit.
+static void pool_release(SDL_Texture* texture, int num_bytes) {
+    Uint32 format;
+    int access, w, h;
+    if (0 != SDL_QueryTexture(texture, &format, &access, &w, &h)
+            || access != SDL_TEXTUREACCESS_STATIC
+            || (max_num_texture_bytes && num_texture_bytes + num_pool_bytes + num_bytes > max_num_texture_bytes)) {
+        SDL_DestroyTexture(texture);
+        ++pool_stats.destroyed;
+        return;
+    }
+    int slot = -1;
+    for(int ix=0; ix < TCACHE_POOL_SIZE; ++ix) {
+        if (pool[ix].texture == NULL) {
+            slot = ix;
+            break;
+        }
+        if (slot < 0 || pool[ix].seq < pool[slot].seq) {
+            slot = ix;
+        }
+    }
+    if (pool[slot].texture) {
+        pool_destroy(slot);
+    }
+    pool[slot].texture = texture;
+    pool[slot].w = w;
+    pool[slot].h = h;
+    pool[slot].format = format;
+    pool[slot].access = access;
+    pool[slot].num_bytes = num_bytes;
+    pool[slot].seq = ++pool_seq;
+    num_pool_bytes += num_bytes;
+}
+
+static SDL_Texture* pool_acquire(int w, int h, Uint32 format, int access) {
+    for(int ix=0; ix < TCACHE_POOL_SIZE; ++ix) {
+        if (pool[ix].texture && pool[ix].w == w && pool[ix].h == h
+                && pool[ix].format == format && pool[ix].access == access) {
+            SDL_Texture* texture = pool[ix].texture;
+            num_pool_bytes -= pool[ix].num_bytes;
+            pool[ix].texture = NULL;
+            pool[ix].num_bytes = 0;
+            return texture;
+        }
+    }
+    return NULL;
+}
+
+// Upload surface pixels to a pooled texture.
+static SDL_Texture* pool_update_texture(SDL_Texture* texture, Uint32 format, SDL_Surface* surface) {
+    SDL_Surface* converted = NULL;
+    if (surface->format->format != format) {
+        converted = SDL_ConvertSurfaceFormat(surface, format, 0);
+        if (converted == NULL) {
+            SDL_ClearError();
+            SDL_DestroyTexture(texture);
+            ++pool_stats.destroyed;
+            return NULL;
+        }
+        surface = converted;
+    }
+    SDL_LockSurface(surface);
+    int rc = SDL_UpdateTexture(texture, NULL, surface->pixels, surface->pitch);
+    SDL_UnlockSurface(surface);
+    if (converted) {
+        SDL_FreeSurface(converted);
+    }
+    if (rc != 0) {
+        error_printf("pool_update_texture: %s\n", SDL_GetError());
+        SDL_ClearError();
+        SDL_DestroyTexture(texture);
+        ++pool_stats.destroyed;
+        return NULL;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_ISPIXELFORMAT_ALPHA(format) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+    return texture;
+}
+
+static bool tcache_eject(unsigned increment, bool (*check)(int, int));
+static bool test_cap_exceeded(int increment, int ejected_count);
+
+// Whether a texture creation failure is the renderer running out of
+// memory, rather than an oversized image or an unsupported format.
+static bool texture_alloc_failed(SDL_Renderer* renderer, SDL_Surface* surface) {
+    SDL_RendererInfo info;
+    if (0 == SDL_GetRendererInfo(renderer, &info)
+            && ((info.max_texture_width && surface->w > info.max_texture_width)
+                || (info.max_texture_height && surface->h > info.max_texture_height))) {
+        return false;
+    }
+    // SDL_OutOfMemory and the GL_OUT_OF_MEMORY error of the GL renderers
+    char error[128];
+    snprintf(error, sizeof(error), "%s", SDL_GetError());
+    for (char* c = error; *c; ++c) {
+        *c = tolower(*c);
+    }
+    return strstr(error, "memory") != NULL;
+}
+
+// Texture creation failed because the renderer is out of texture memory.
+// Release pooled textures then eject least recently used textures,
+// retrying after each step, at most once per frame. With the automatic
+// limit the texture bytes in use at the failure is the allocation
+// ceiling, the cache limit is capped at that but not below the working set.
+static SDL_Texture* texture_from_surface_retry(SDL_Renderer* renderer, SDL_Surface* surface) {
+    static uint32_t eject_frame;
+    bool out_of_memory = texture_alloc_failed(renderer, surface);
+    error_printf("texture_from_surface: %dx%d failed: %s, texture bytes=%u pooled=%u\n",
+            surface->w, surface->h, SDL_GetError(), num_texture_bytes, num_pool_bytes);
+    SDL_ClearError();
+    if (!out_of_memory) {
+        return NULL;
+    }
+    if (auto_limit) {
+        unsigned ceiling = MAX(num_texture_bytes, working_set_bytes);
+        if (alloc_ceiling == 0 || ceiling < alloc_ceiling) {
+            alloc_ceiling = ceiling;
+            if (max_num_texture_bytes == 0 || max_num_texture_bytes > alloc_ceiling) {
+                max_num_texture_bytes = alloc_ceiling;
+            }
+        }
+    }
+    SDL_Texture* texture = NULL;
+    if (num_pool_bytes) {
+        pool_trim(0);
+        texture = SDL_CreateTextureFromSurface(renderer, surface);
+    }
+    if (texture || eject_frame == lru_counter) {
+        return texture;
+    }
+    eject_frame = lru_counter;
+    // tcache_eject requires at least one candidate to remain in the table.
+    for(int retry=0; texture == NULL && retry < TCACHE_ALLOC_RETRIES
+            && lru_eject.ix + 1 < lru_eject.count; ++retry) {
+        SDL_ClearError();
+        tcache_eject(0, test_cap_exceeded);
+        texture = SDL_CreateTextureFromSurface(renderer, surface);
+    }
+    return texture;
+}
+
+// Create a texture from a surface, reusing a pooled texture if one matches.
+// Pool lookup is first by the surface format, then by ARGB8888 the format
+// textures are typically created in.
+static SDL_Texture* texture_from_surface(SDL_Renderer* renderer, SDL_Surface* surface) {
+    const Uint32 formats[] = {surface->format->format, SDL_PIXELFORMAT_ARGB8888};
+    int64_t ms_0 = get_micro_seconds();
+    for(int ix=0; ix < sizeof(formats)/sizeof(formats[0]); ++ix) {
+        SDL_Texture* texture = pool_acquire(surface->w, surface->h, formats[ix], SDL_TEXTUREACCESS_STATIC);
+        if (texture) {
+            texture = pool_update_texture(texture, formats[ix], surface);
+            if (texture) {
+                ++pool_stats.hits;
+                pool_stats.update_usecs += get_micro_seconds() - ms_0;
+                return texture;
+            }
+        }
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    if (texture == NULL) {
+        texture = texture_from_surface_retry(renderer, surface);
+    }
+    if (texture) {
+        ++pool_stats.misses;
+        pool_stats.create_usecs += get_micro_seconds() - ms_0;
+    }
+    return texture;
+}
+
+void tcache_get_pool_stats(tcache_pool_stats* stats) {
+    *stats = pool_stats;
+    stats->pooled_bytes = num_pool_bytes;
+    // time saved is estimated from the mean time to create a texture
+    stats->saved_usecs = 0;
+    if (pool_stats.misses) {
+        stats->saved_usecs = (pool_stats.create_usecs * pool_stats.hits) / pool_stats.misses - pool_stats.update_usecs;
+    }
+}
+
+// Called before textures are released, so that a renderer client can
+// submit pending draws of textures which are about to be pooled or destroyed.
+static void (*release_hook)(void*);
+static void* release_hook_context;
+
+void tcache_set_release_hook(void (*hook)(void*), void* context) {
+    release_hook = hook;
+    release_hook_context = context;
+}
+
+static inline void call_release_hook(void) {
+    if (release_hook) {
+        release_hook(release_hook_context);
+    }
+}
+
+static void release_mip_textures(tcache_entry* tce) {
+    for(int ix=0; ix < tce->num_mips; ++ix) {
+        tcache_mip* mip = tce->mips + ix;
+        if (mip->texture) {
+            call_release_hook();
+            SDL_Texture* texture = (SDL_Texture*)mip->texture;
+            mip->texture = NULL;
+            num_texture_bytes -= mip->num_bytes;
+            pool_release(texture, mip->num_bytes);
+            mip->num_bytes = 0;
+        }
+    }
+}
+
+static void free_mip_surfaces(tcache_entry* tce) {
+    for(int ix=0; ix < tce->num_mips; ++ix) {
+        SDL_Surface* surface = __atomic_exchange_n(&tce->mips[ix].surface, NULL, __ATOMIC_ACQ_REL);
+        if (surface) {
+            __atomic_sub_fetch(&num_surface_bytes, 4 * surface->w * surface->h, __ATOMIC_ACQ_REL);
+            SDL_FreeSurface(surface);
+        }
+    }
+}
+
+// true if a texture exists for any level of the entry
+static bool tce_has_texture(tcache_entry* tce) {
+    if (__atomic_load_n(&tce->texture, __ATOMIC_ACQUIRE)) {
+        return true;
+    }
+    for(int ix=0; ix < tce->num_mips; ++ix) {
+        if (__atomic_load_n(&tce->mips[ix].texture, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void release_texture(tcache_entry* tce) {
     assert(external_tce(tce));
+    if (external_tce(tce)) {
+        release_mip_textures(tce);
+    }
     if (external_tce(tce) && tce->texture) {
+        call_release_hook();
         int64_t ms_0 = get_micro_seconds();
-        SDL_DestroyTexture((SDL_Texture*)tce->texture);
-        int64_t ms_1 = get_micro_seconds();
-//        perf_printf("release_texture: destroy_texture: %07.2f millis\n", (float)(ms_1 - ms_0)/1000);
+        SDL_Texture* texture = (SDL_Texture*)tce->texture;
         tce->texture = NULL;
         num_texture_bytes -= tce->num_bytes;
+        pool_release(texture, tce->num_bytes);
+        int64_t ms_1 = get_micro_seconds();
+//        perf_printf("release_texture: destroy_texture: %07.2f millis\n", (float)(ms_1 - ms_0)/1000);
         tce->w = tce->h = tce->num_bytes = 0;
         profile_texture_printf("release_texture: destroy_texture: %06lu usec %u/%u\n", ms_1 - ms_0, num_texture_bytes, max_num_texture_bytes);
         tcache_printf("release_texture: texture_bytes=%d\n", num_texture_bytes);
@@ -226,10 +640,14 @@ static void update_texture(tcache_entry* tce, const SDL_Texture* texture) {
             if (0 == SDL_QueryTexture((SDL_Texture*)texture, &fmt, NULL, &tce->w, &tce->h)) {
                 tce->num_bytes = SDL_BYTESPERPIXEL(fmt) * tce->w * tce->h;
                 num_texture_bytes += tce->num_bytes;
+                tce->ws_bytes = MAX(tce->ws_bytes, tce->num_bytes);
                 tcache_printf("update_texture: texture_bytes=%d %s\n", num_texture_bytes, tce->path);
             }
             tce->texture = texture;
-            SDL_SetTextureScaleMode((SDL_Texture*)texture, SDL_ScaleModeBest);
+            SDL_SetTextureScaleMode((SDL_Texture*)texture, scale_mode);
+            if (tce->opaque) {
+                SDL_SetTextureBlendMode((SDL_Texture*)texture, SDL_BLENDMODE_NONE);
+            }
         }
         // TODO: do this before creating the texture
         tcache_cap_num_bytes(0);
@@ -250,7 +668,7 @@ int compare_tce_paths(const char* path1, const char* path2) {
     return strcmp(path1, path2);
 }
 
-texture_id_t tcache_create_entry(const char* path) {
+static texture_id_t _tcache_create_entry(const char* path) {
     if (path == NULL) {
         error_printf("tcache_create_entry: path pointer is NULL\n");
         exit(EXIT_FAILURE);
@@ -291,18 +709,18 @@ texture_id_t tcache_create_entry(const char* path) {
                 // another entry was added to the candidate slot continue searching for a free slot.
             } else {
                 if (tce->hashv == hashv && 0 == compare_tce_paths(path,  tce->path)) {
-                    tcache_lock(&delete_lock);
-                    if (unoccupied_tce(tce)) {
-                        // entry was deleted whilst acquiring the lock, probe the entry again
-                        --count;
+                    // ensure that the entry is not deleted, unless deletion is in progress
+                    // in which case continue searching for a free slot.
+                    uint8_t state = TCE_DELETE_REQUESTED;
+                    if (!__atomic_compare_exchange_n(&tce->delete, &state, TCE_LIVE, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                        state = __atomic_load_n(&tce->delete, __ATOMIC_ACQUIRE);
                     } else {
+                        state = TCE_LIVE;
+                    }
+                    if (state == TCE_LIVE) {
                         tcache_printf("tcache_create_texture: found: tce=%p %d %s\n", tce, indx, tce->path);
-                        // ensure that the entry is not deleted
-                        tce->delete = false;
-                        tcache_unlock(&delete_lock);
                         return indx;
                     }
-                    tcache_unlock(&delete_lock);
                 }
             }
         }
@@ -315,6 +733,13 @@ texture_id_t tcache_create_entry(const char* path) {
     return -1;
 }
 
+texture_id_t tcache_create_entry(const char* path) {
+    epoch_enter();
+    texture_id_t texture_id = _tcache_create_entry(path);
+    epoch_exit();
+    return texture_id;
+}
+
 // Get texture using the path/token
 // path: path to image file - or unique string identifier
 // texture_id*: quick access texture ID
@@ -334,7 +759,7 @@ SDL_Texture* tcache_get_texture(const char* path, texture_id_t* texture_id, SDL_
             if (texture_id) {
                 *texture_id = indx;
             }
-            return tcache_quick_get_texture(indx, renderer);
+            return tcache_quick_get_texture(indx, renderer, NULL, NULL);
         }
         indx = (indx+COLLISION_STEP)%HASHTPRIME;
         tce = tbl[indx];
@@ -347,11 +772,85 @@ SDL_Texture* tcache_get_texture(const char* path, texture_id_t* texture_id, SDL_
     return NULL;
 }
 
+static void record_reuse_distance(uint32_t distance) {
+    int bucket = 0;
+    while (distance > 1 && bucket < TCACHE_REUSE_BUCKETS-1) {
+        distance >>= 1;
+        ++bucket;
+    }
+    ++reuse_hist[bucket];
+}
+
+// Select the smallest level which is not smaller than the destination,
+// so that textures are only ever scaled down.
+static int select_mip_level(tcache_entry* tce, const SDL_Rect* dst_rect, const SDL_Rect* src_rect) {
+    int level = 0;
+    if (dst_rect == NULL || tce->w == 0 || tce->h == 0) {
+        return level;
+    }
+    int src_w = src_rect ? src_rect->w : tce->w;
+    int src_h = src_rect ? src_rect->h : tce->h;
+    int num_mips = __atomic_load_n(&tce->num_mips, __ATOMIC_ACQUIRE);
+    for(int ix=0; ix < num_mips; ++ix) {
+        tcache_mip* mip = tce->mips + ix;
+        if ((src_w * mip->w)/tce->w < dst_rect->w || (src_h * mip->h)/tce->h < dst_rect->h) {
+            break;
+        }
+        if (__atomic_load_n(&mip->texture, __ATOMIC_ACQUIRE) || __atomic_load_n(&mip->surface, __ATOMIC_ACQUIRE)) {
+            level = ix + 1;
+        }
+    }
+    return level;
+}
+
+static SDL_Texture* mip_get_texture(tcache_entry* tce, int level, SDL_Renderer* renderer, SDL_Rect* src_rect) {
+    tcache_mip* mip = tce->mips + level - 1;
+    SDL_Surface* surface = __atomic_exchange_n(&mip->surface, NULL, __ATOMIC_ACQ_REL);
+    if (surface != NULL) {
+        int64_t ms_ct_0 =get_micro_seconds();
+        SDL_Texture* texture = texture_from_surface(renderer, surface);
+        int64_t ms_ct_1 =get_micro_seconds();
+        if (NULL == texture) {
+            error_printf("tcache_quick_get_texture: mip %d failed: %s %s\n", level, tce->path, SDL_GetError());
+            SDL_ClearError();
+        } else {
+            if (mip->texture) {
+                call_release_hook();
+                num_texture_bytes -= mip->num_bytes;
+                pool_release((SDL_Texture*)mip->texture, mip->num_bytes);
+            }
+            SDL_SetTextureScaleMode(texture, scale_mode);
+            if (tce->opaque) {
+                SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
+            }
+            mip->num_bytes = 4 * surface->w * surface->h;
+            num_texture_bytes += mip->num_bytes;
+            if (tce->texture == NULL) {
+                tce->ws_bytes = MAX(tce->ws_bytes, mip->num_bytes);
+            }
+            __atomic_store_n(&mip->texture, texture, __ATOMIC_RELEASE);
+        }
+        __atomic_sub_fetch(&num_surface_bytes, 4 * surface->w * surface->h, __ATOMIC_ACQ_REL);
+        SDL_FreeSurface(surface);
+        profile_texture_printf("texture_resolve: create_texture: mip %d %06lu usec %u/%u\n", level, ms_ct_1 - ms_ct_0, num_texture_bytes, max_num_texture_bytes);
+        tcache_cap_num_bytes(0);
+    }
+    if (mip->texture && src_rect) {
+        src_rect->x = (src_rect->x * mip->w)/tce->w;
+        src_rect->y = (src_rect->y * mip->h)/tce->h;
+        src_rect->w = (src_rect->w * mip->w)/tce->w;
+        src_rect->h = (src_rect->h * mip->h)/tce->h;
+    }
+    return (SDL_Texture *)mip->texture;
+}
+
 // Get texture using the quick access texture ID
 // texture_id*: quick access texture ID
+// dst_rect: destination rect, selects the level, NULL for full size
+// src_rect: optional source rect, scaled to the selected level
 // returns: texture, NULL is the texture is not found
 //          texture ID
-SDL_Texture* tcache_quick_get_texture(texture_id_t texture_id, SDL_Renderer* renderer) {
+SDL_Texture* tcache_quick_get_texture(texture_id_t texture_id, SDL_Renderer* renderer, const SDL_Rect* dst_rect, SDL_Rect* src_rect) {
     if (!check_permitted()) {
         return NULL;
     }
@@ -365,11 +864,24 @@ SDL_Texture* tcache_quick_get_texture(texture_id_t texture_id, SDL_Renderer* ren
     tcache_entry* tce = tbl[texture_id];
     if (!unoccupied_tce(tce)) {
 //        tcache_printf("tcache_quick_get_texture: %d %u %s\n", texture_id, tce->hashv, tce->path);
-        __atomic_store_n(&tce->lru_count, lru_counter, __ATOMIC_RELEASE);
+        uint32_t distance = lru_counter - __atomic_exchange_n(&tce->lru_count, lru_counter, __ATOMIC_ACQ_REL);
+        if (distance > 1) {
+            record_reuse_distance(distance);
+        }
+
+        int level = select_mip_level(tce, dst_rect, src_rect);
+        if (level) {
+            SDL_Texture* texture = mip_get_texture(tce, level, renderer, src_rect);
+            if (texture) {
+                return texture;
+            }
+        }
 
-        if (tce->surface != NULL) {
+        // ownership of a published surface passes to the render thread
+        SDL_Surface* surface = __atomic_exchange_n(&tce->surface, NULL, __ATOMIC_ACQ_REL);
+        if (surface != NULL) {
             int64_t ms_ct_0 =get_micro_seconds();
-            SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, tce->surface);
+            SDL_Texture* texture = texture_from_surface(renderer, surface);
             int64_t ms_ct_1 =get_micro_seconds();
 //            perf_printf("texture_resolve: create_texture: %07.2f millis\n", (float)(ms_ct_1 - ms_ct_0)/1000);
             if (NULL == texture) {
@@ -377,9 +889,8 @@ SDL_Texture* tcache_quick_get_texture(texture_id_t texture_id, SDL_Renderer* ren
                 SDL_ClearError();
             }
             update_texture(tce, texture);
-            SDL_FreeSurface(tce->surface);
-            __atomic_sub_fetch(&num_surface_bytes, 4 * tce->w * tce->h, __ATOMIC_ACQ_REL);
-            tce->surface = NULL;
+            __atomic_sub_fetch(&num_surface_bytes, 4 * surface->w * surface->h, __ATOMIC_ACQ_REL);
+            SDL_FreeSurface(surface);
             profile_texture_printf("texture_resolve: create_texture: %06lu usec %u/%u\n", ms_ct_1 - ms_ct_0, num_texture_bytes, max_num_texture_bytes);
         }
         if (tce->texture == NULL) {
@@ -412,17 +923,29 @@ bool tcache_quick_get_texture_ejected(texture_id_t texture_id) {
     return false;
 }
 
+// Free an entry once no thread can be accessing it.
+static void free_tce(tcache_entry* tce) {
+    free_mip_surfaces(tce);
+    if (tce->surface) {
+        __atomic_sub_fetch(&num_surface_bytes, 4 * tce->surface->w * tce->surface->h, __ATOMIC_ACQ_REL);
+        SDL_FreeSurface(tce->surface);
+    }
+    if (tce->path) {
+        free((void *)tce->path);
+    }
+    free(tce);
+}
+
+// Remove an entry from the table, textures are released immediately,
+// other resources when the entry is reclaimed.
 static void _delete_texture(texture_id_t texture_id) {
     tcache_entry* tce = tbl[texture_id];
     assert(external_tce(tce));
     if (external_tce(tce)) {
         tcache_printf("tcache_quick_delete_texture: %d %p\n", texture_id, tce);
         release_texture(tce);
-        if (tce->path) {
-            free((void *)tce->path);
-        }
-        free(tce);
-        __atomic_store_n(tbl+texture_id, tce_deleted, __ATOMIC_RELEASE);
+        __atomic_store_n(tbl+texture_id, tce_deleted, __ATOMIC_SEQ_CST);
+        retire_tce(tce);
     }
 }
 
@@ -434,20 +957,21 @@ bool tcache_quick_delete_texture(texture_id_t texture_id) {
         exit(EXIT_FAILURE);
         return false;
     }
-    tcache_entry* tce = tbl[texture_id];
+    epoch_enter();
+    tcache_entry* tce = __atomic_load_n(tbl + texture_id, __ATOMIC_ACQUIRE);
+    bool rv = false;
     if (tce == tce_deleted) {
-        return true;
-    }
-    if (external_tce(tce)) {
-        tcache_lock(&delete_lock);
-        tce->delete = true;
+        rv = true;
+    } else if (external_tce(tce)) {
+        uint8_t state = TCE_LIVE;
+        __atomic_compare_exchange_n(&tce->delete, &state, TCE_DELETE_REQUESTED, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
         __atomic_test_and_set(&delete_requested, __ATOMIC_ACQ_REL);
-        tcache_unlock(&delete_lock);
-        return true;
+        rv = true;
     } else {
         error_printf("tcache_quick_delete_texture: none: %d\n", texture_id);
     }
-    return false;
+    epoch_exit();
+    return rv;
 }
 
 // Delete texture 
@@ -478,7 +1002,7 @@ static int lru_sort_tce(tcache_entry** lru_sorted_tbl) {
         // candidates for ejection must have a texture
         if (external_tce(tce) 
                 && 
-                __atomic_load_n(&tce->texture, __ATOMIC_ACQUIRE)
+                tce_has_texture(tce)
                 &&
                 !tce->locked) {
            lru_sorted_tbl[indx] = tce;
@@ -493,12 +1017,6 @@ static bool cap_exceeded(int increment, int ejected) {
     return max_num_texture_bytes && (num_texture_bytes + increment) > max_num_texture_bytes;
 }
 
-static struct {
-    tcache_entry* tbl[HASHTPRIME];
-    int count;
-    int ix;
-} lru_eject;
-
 // Eject least recently used textures to reduce texture bytes to the configured limit
 // TODO: this potentially expensive function in terms of time is called within the
 // context of the renderer thread.
@@ -515,7 +1033,7 @@ static bool tcache_eject(unsigned increment, bool (*check)(int, int)) {
 //    for(int ix=0; ix < count && check(increment, ejected_count); ++ix) {
     for(; lru_eject.ix < lru_eject.count && check(increment, ejected_count); ++lru_eject.ix) {
         tcache_entry* tce = lru_eject.tbl[lru_eject.ix];
-        if (!tce->locked && tce->texture) {
+        if (!tce->locked && tce_has_texture(tce)) {
             release_texture(tce);
             tce->ejected = true;
             ++ejected_count;
@@ -531,11 +1049,242 @@ static bool tcache_eject(unsigned increment, bool (*check)(int, int)) {
 
 // Eject least recently used textures to reduce texture bytes to the configured limit
 static void tcache_cap_num_bytes(unsigned increment) {
+    // release pooled textures before ejecting textures in use
+    if (max_num_texture_bytes) {
+        pool_trim(max_num_texture_bytes > increment ? max_num_texture_bytes - increment : 0);
+    }
     if( max_num_texture_bytes && (num_texture_bytes + increment) > max_num_texture_bytes ) {
         tcache_eject(increment, cap_exceeded);
     }
 }
 
+// Average 2x2 blocks of pixels, colour is weighted by alpha, so that
+// fully transparent pixels do not bleed into the edges of opaque regions.
+// src must be 32 bits per pixel with alpha in the most significant byte.
+static SDL_Surface* mip_downscale(SDL_Surface* src) {
+    SDL_Surface* dst = SDL_CreateRGBSurfaceWithFormat(0, src->w/2, src->h/2, 32, src->format->format);
+    if (dst == NULL) {
+        return NULL;
+    }
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for(int y=0; y < dst->h; ++y) {
+        const Uint32* row0 = (const Uint32*)((const Uint8*)src->pixels + (2*y) * src->pitch);
+        const Uint32* row1 = (const Uint32*)((const Uint8*)src->pixels + (2*y + 1) * src->pitch);
+        Uint32* out = (Uint32*)((Uint8*)dst->pixels + y * dst->pitch);
+        for(int x=0; x < dst->w; ++x) {
+            Uint32 px[4] = {row0[2*x], row0[2*x+1], row1[2*x], row1[2*x+1]};
+            Uint32 a = 0, c2 = 0, c1 = 0, c0 = 0;
+            for(int i=0; i < 4; ++i) {
+                Uint32 pa = px[i] >> 24;
+                a += pa;
+                c2 += ((px[i] >> 16) & 0xff) * pa;
+                c1 += ((px[i] >> 8) & 0xff) * pa;
+                c0 += (px[i] & 0xff) * pa;
+            }
+            if (a) {
+                c2 /= a; c1 /= a; c0 /= a;
+            }
+            out[x] = ((a/4) << 24) | (c2 << 16) | (c1 << 8) | c0;
+        }
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+    return dst;
+}
+
+// true if any pixel in the row is not fully transparent,
+// pixels are tested 4 at a time, two per 64 bit word.
+static inline bool row_has_alpha(const Uint32* row, int w) {
+    uint64_t acc = 0;
+    int x = 0;
+    for(; x + 4 <= w; x += 4) {
+        uint64_t a, b;
+        memcpy(&a, row + x, sizeof(a));
+        memcpy(&b, row + x + 2, sizeof(b));
+        acc |= a | b;
+    }
+    acc &= 0xff000000ff000000ull;
+    for(; x < w; ++x) {
+        acc |= row[x] & 0xff000000;
+    }
+    return acc != 0;
+}
+
+// Bounding box of the pixels which are not fully transparent,
+// returns false if all pixels are transparent.
+// surface must be ARGB8888
+static bool alpha_bounds(SDL_Surface* surface, SDL_Rect* bounds) {
+    const Uint8* pixels = surface->pixels;
+    int top = 0, bottom = surface->h - 1;
+    while (top <= bottom && !row_has_alpha((const Uint32*)(pixels + top * surface->pitch), surface->w)) {
+        ++top;
+    }
+    if (top > bottom) {
+        return false;
+    }
+    while (!row_has_alpha((const Uint32*)(pixels + bottom * surface->pitch), surface->w)) {
+        --bottom;
+    }
+    int left = surface->w - 1, right = 0;
+    for(int y=top; y <= bottom; ++y) {
+        const Uint32* row = (const Uint32*)(pixels + y * surface->pitch);
+        for(int x=0; x < left; ++x) {
+            if (row[x] & 0xff000000) {
+                left = x;
+                break;
+            }
+        }
+        for(int x=surface->w - 1; x > right; --x) {
+            if (row[x] & 0xff000000) {
+                right = x;
+                break;
+            }
+        }
+    }
+    if (left > right) {
+        // single column
+        right = left;
+    }
+    bounds->x = left;
+    bounds->y = top;
+    bounds->w = right - left + 1;
+    bounds->h = bottom - top + 1;
+    return true;
+}
+
+// true if every pixel of the surface is fully opaque,
+// 32 bit pixels are tested two per 64 bit word.
+static bool surface_opaque(SDL_Surface* surface) {
+    if (SDL_HasColorKey(surface)) {
+        return false;
+    }
+    const Uint32 amask = surface->format->Amask;
+    if (amask == 0) {
+        return true;
+    }
+    if (surface->format->BytesPerPixel != 4) {
+        return false;
+    }
+    const uint64_t amask64 = ((uint64_t)amask << 32) | amask;
+    uint64_t acc = amask64;
+    SDL_LockSurface(surface);
+    for(int y=0; y < surface->h && acc == amask64; ++y) {
+        const Uint32* row = (const Uint32*)((const Uint8*)surface->pixels + y * surface->pitch);
+        int x = 0;
+        for(; x + 2 <= surface->w; x += 2) {
+            uint64_t a;
+            memcpy(&a, row + x, sizeof(a));
+            acc &= a;
+        }
+        if (x < surface->w) {
+            acc &= ((uint64_t)row[x] << 32) | row[x];
+        }
+    }
+    SDL_UnlockSurface(surface);
+    return acc == amask64;
+}
+
+// Crop a surface to the bounding box of pixels which are not fully
+// transparent. Returns the cropped surface and sets trim_rect, the
+// surface is freed, or the surface itself if it is not trimmed.
+static SDL_Surface* trim_surface(SDL_Surface* surface, const char* path, SDL_Rect* trim_rect) {
+    if (!SDL_ISPIXELFORMAT_ALPHA(surface->format->format)) {
+        return surface;
+    }
+    int64_t ms_0 = get_micro_seconds();
+    SDL_Surface* argb = surface;
+    if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        argb = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        if (argb == NULL) {
+            error_printf("trim_surface: convert failed: %s %s\n", path, SDL_GetError());
+            SDL_ClearError();
+            return surface;
+        }
+    }
+    SDL_Surface* trimmed = surface;
+    SDL_LockSurface(argb);
+    SDL_Rect bounds;
+    if (alpha_bounds(argb, &bounds) && (bounds.w < argb->w || bounds.h < argb->h)) {
+        SDL_Surface* cropped = SDL_CreateRGBSurfaceWithFormat(0, bounds.w, bounds.h, 32, SDL_PIXELFORMAT_ARGB8888);
+        if (cropped) {
+            for(int y=0; y < bounds.h; ++y) {
+                memcpy((Uint8*)cropped->pixels + y * cropped->pitch,
+                        (const Uint8*)argb->pixels + (bounds.y + y) * argb->pitch + bounds.x * 4,
+                        bounds.w * 4);
+            }
+            *trim_rect = bounds;
+            trimmed = cropped;
+            tcache_printf("trim_surface: %dx%d -> {%d,%d,%d,%d} %s\n",
+                    surface->w, surface->h, bounds.x, bounds.y, bounds.w, bounds.h, path);
+        }
+    }
+    SDL_UnlockSurface(argb);
+    if (argb != surface) {
+        SDL_FreeSurface(argb);
+    }
+    if (trimmed != surface) {
+        SDL_FreeSurface(surface);
+    }
+    int64_t ms_1 = get_micro_seconds();
+    profile_texture_printf("trim_surface: %06lu usec %s\n", ms_1 - ms_0, path);
+    return trimmed;
+}
+
+// Generate downscaled levels for an entry from the full size surface,
+// before the surface is published. Levels which already have a surface
+// or texture are retained, the render thread may be reading the levels
+// below num_mips, their dimensions are unchanged on reload. num_mips is
+// stored last.
+static void generate_mips(tcache_entry* tce, SDL_Surface* full) {
+    if (full->w/2 < TCACHE_MIP_MIN_DIM || full->h/2 < TCACHE_MIP_MIN_DIM) {
+        return;
+    }
+    int64_t ms_0 = get_micro_seconds();
+    int num_mips = __atomic_load_n(&tce->num_mips, __ATOMIC_ACQUIRE);
+    SDL_Surface* src = SDL_ConvertSurfaceFormat(full, SDL_PIXELFORMAT_ARGB8888, 0);
+    if (src == NULL) {
+        error_printf("generate_mips: convert failed: %s %s\n", tce->path, SDL_GetError());
+        SDL_ClearError();
+        return;
+    }
+    bool free_src = true;
+    int level = 0;
+    for(; level < TCACHE_MAX_MIP_LEVELS
+            && src->w/2 >= TCACHE_MIP_MIN_DIM && src->h/2 >= TCACHE_MIP_MIN_DIM; ++level) {
+        SDL_Surface* surface = mip_downscale(src);
+        if (free_src) {
+            SDL_FreeSurface(src);
+        }
+        src = surface;
+        free_src = true;
+        if (surface == NULL) {
+            error_printf("generate_mips: downscale failed: %s level %d\n", tce->path, level+1);
+            break;
+        }
+        tcache_mip* mip = tce->mips + level;
+        if (level >= num_mips) {
+            mip->w = surface->w;
+            mip->h = surface->h;
+        }
+        if (__atomic_load_n(&mip->texture, __ATOMIC_ACQUIRE) == NULL) {
+            SDL_Surface* expected = NULL;
+            if (__atomic_compare_exchange_n(&mip->surface, &expected, surface, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                __atomic_add_fetch(&num_surface_bytes, 4 * surface->w * surface->h, __ATOMIC_ACQ_REL);
+                free_src = false;
+            }
+        }
+    }
+    if (src && free_src) {
+        SDL_FreeSurface(src);
+    }
+    if (level > num_mips) {
+        __atomic_store_n(&tce->num_mips, level, __ATOMIC_RELEASE);
+    }
+    int64_t ms_1 = get_micro_seconds();
+    profile_texture_printf("generate_mips: %06lu usec %d levels %s\n", ms_1 - ms_0, level, tce->path);
+}
+
 static bool test_cap_exceeded(int increment, int ejected_count) {
     return ejected_count == 0;
 }
@@ -553,50 +1302,84 @@ bool tcache_test_lru_eject() {
 // renderer : SDL renderer context
 // returns : texture, NULL is the texture is not found
 //          texture ID or -1 is texture is not found
-bool tcache_load_from_file(texture_id_t texture_id, SDL_Renderer* renderer) {
+static bool _tcache_load_from_file(texture_id_t texture_id, SDL_Renderer* renderer) {
     if (texture_id < 0 || texture_id >= NUM_TBL_ENTRIES) {
         error_printf("tcache_load_from_file: invalid id %d\n", texture_id);
         exit(EXIT_FAILURE);
     }
-    tcache_entry* tce = tbl[texture_id];
+    tcache_entry* tce = __atomic_load_n(tbl + texture_id, __ATOMIC_ACQUIRE);
     // empty entry: with nothing to do, no file and texture is associated with this entry
     if (tce == &empty_tce) {
         return true;
     }
-    tcache_lock(&delete_lock);
     if (!unoccupied_tce(tce)) {
         // prevent the entry from being deleted.
-        tce->delete = false;
+        uint8_t state = TCE_DELETE_REQUESTED;
+        __atomic_compare_exchange_n(&tce->delete, &state, TCE_LIVE, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        if (state == TCE_DELETING) {
+            error_printf("tcache_load_from_file: deleted: %d\n", texture_id);
+            return false;
+        }
     }
-    tcache_unlock(&delete_lock);
     if (!unoccupied_tce(tce)) {
+        // entries are loaded by the loader threads, the input thread and
+        // the render thread, one thread decodes, others wait for it.
+        while (__atomic_test_and_set(&tce->loading, __ATOMIC_ACQUIRE)) {
+            SDL_Delay(1);
+        }
         // loading is only required if the associated texture or surface does not exist
-        if (tce->texture == NULL && tce->surface == NULL) {
+        if (__atomic_load_n(&tce->texture, __ATOMIC_ACQUIRE) == NULL
+                && __atomic_load_n(&tce->surface, __ATOMIC_ACQUIRE) == NULL) {
             tcache_printf("tcache_load_from_file: : %d %s\n", texture_id, tce->path);
-            tce->surface = IMG_Load(tce->path);
-            if (tce->surface == NULL)  {
+            SDL_Surface* surface = IMG_Load(tce->path);
+            if (surface == NULL)  {
                 error_printf("tcache_load_from_file: failed: %d %s\n", texture_id, tce->path);
             } else {
-                tce->w = tce->surface->w;
-                tce->h = tce->surface->h;
-                __atomic_add_fetch(&num_surface_bytes, 4 * tce->w * tce->h, __ATOMIC_ACQ_REL);
+                int full_w = surface->w;
+                int full_h = surface->h;
+                SDL_Rect trim_rect;
+                SDL_Surface* trimmed = tce->trim ? trim_surface(surface, tce->path, &trim_rect) : surface;
+                if (trimmed != surface) {
+                    tce->full_w = full_w;
+                    tce->full_h = full_h;
+                    tce->trim_rect = trim_rect;
+                    __atomic_store_n(&tce->trimmed, true, __ATOMIC_RELEASE);
+                }
+                generate_mips(tce, trimmed);
+                // textures are created with the blend mode of the entry,
+                // and the surface bytes are released, when it is published
+                tce->opaque = surface_opaque(trimmed);
+                tce->w = trimmed->w;
+                tce->h = trimmed->h;
+                __atomic_add_fetch(&num_surface_bytes, 4 * trimmed->w * trimmed->h, __ATOMIC_ACQ_REL);
+                // the render thread takes ownership of published surfaces
+                __atomic_store_n(&tce->surface, trimmed, __ATOMIC_RELEASE);
                 tcache_eject_printf("tcache_load_from_file: loaded: %s\n", tce->path);
             }
         } else {
             tcache_eject_printf("tcache_load_from_file: %s\n", tce->path);
         }
+        __atomic_clear(&tce->loading, __ATOMIC_RELEASE);
         __atomic_store_n(&tce->lru_count, lru_counter, __ATOMIC_RELEASE);
-        return tce->texture != NULL || tce->surface !=NULL; 
+        return __atomic_load_n(&tce->texture, __ATOMIC_ACQUIRE) != NULL
+            || __atomic_load_n(&tce->surface, __ATOMIC_ACQUIRE) != NULL;
     }
     error_printf("tcache_load_from_file: invalid: %d\n", texture_id);
     return false;
 }
 
+bool tcache_load_from_file(texture_id_t texture_id, SDL_Renderer* renderer) {
+    epoch_enter();
+    bool loaded = _tcache_load_from_file(texture_id, renderer);
+    epoch_exit();
+    return loaded;
+}
+
 // Some textures are generated dynamically, (not loaded from files for example)
 // from example status text etc.
 // this function may stall if the previously set surface has not been,
 // resolved by the renderer thread.
-bool tcache_set_surface(texture_id_t texture_id, SDL_Surface* surface) {
+static bool _tcache_set_surface(texture_id_t texture_id, SDL_Surface* surface) {
     if (texture_id < 0 || texture_id >= NUM_TBL_ENTRIES) {
         error_printf("tcache_set_surface: invalid id %d\n", texture_id);
         exit(EXIT_FAILURE);
@@ -607,6 +1390,7 @@ bool tcache_set_surface(texture_id_t texture_id, SDL_Surface* surface) {
     }
     tcache_entry* tce = tbl[texture_id];
     if (external_tce(tce)) {
+        tce->opaque = false;
         if (tce->surface == NULL ) {
             tce->surface = surface;
             return true;
@@ -627,6 +1411,13 @@ bool tcache_set_surface(texture_id_t texture_id, SDL_Surface* surface) {
     return false;
 } 
 
+bool tcache_set_surface(texture_id_t texture_id, SDL_Surface* surface) {
+    epoch_enter();
+    bool rv = _tcache_set_surface(texture_id, surface);
+    epoch_exit();
+    return rv;
+}
+
 // Load texture from file and add it to the texture cache.
 // path : path to image file
 // renderer : SDL renderer context
@@ -642,6 +1433,67 @@ texture_id_t tcache_load_media(const char* path, SDL_Renderer* renderer, bool* p
     return texture_id;
 }
 
+// Mark an entry to be trimmed when it is decoded.
+bool tcache_set_trim(texture_id_t texture_id) {
+    if (texture_id <= 0 || texture_id >= NUM_TBL_ENTRIES) {
+        error_printf("tcache_set_trim: invalid id %d\n", texture_id);
+        exit(EXIT_FAILURE);
+    }
+    epoch_enter();
+    tcache_entry* tce = __atomic_load_n(tbl + texture_id, __ATOMIC_ACQUIRE);
+    bool rv = external_tce(tce);
+    if (rv) {
+        tce->trim = true;
+    }
+    epoch_exit();
+    return rv;
+}
+
+// Load a sprite image, the image is trimmed to the bounding box of
+// pixels which are not fully transparent.
+// path : path to image file
+// renderer : SDL renderer context
+// returns: texture ID
+texture_id_t tcache_load_sprite(const char* path, SDL_Renderer* renderer, bool* ploaded) {
+    texture_id_t texture_id = tcache_create_entry(path);
+    tcache_set_trim(texture_id);
+    bool loaded = tcache_load_from_file(texture_id, renderer);
+    if (ploaded) {
+        *ploaded = loaded;
+    }
+    tcache_printf("tcache_load_sprite: id=%d path=%s loaded=%u\n", texture_id, path, (unsigned)loaded);
+    return texture_id;
+}
+
+// true if the texture is fully opaque
+bool tcache_quick_get_texture_opaque(texture_id_t texture_id) {
+    if (texture_id < 0 || texture_id >= NUM_TBL_ENTRIES) {
+        error_printf("tcache_quick_get_texture_opaque: invalid id %d\n", texture_id);
+        exit(EXIT_FAILURE);
+    }
+    tcache_entry* tce = tbl[texture_id];
+    return external_tce(tce) && tce->opaque;
+}
+
+// Get the trim of a sprite
+// trim: bounding box of the texture within the full size image
+// full_w, full_h: dimensions of the full size image
+// returns: true if the texture has been trimmed.
+bool tcache_quick_get_texture_trim(texture_id_t texture_id, SDL_Rect* trim, int* full_w, int* full_h) {
+    if (texture_id < 0 || texture_id >= NUM_TBL_ENTRIES) {
+        error_printf("tcache_quick_get_texture_trim: invalid id %d\n", texture_id);
+        exit(EXIT_FAILURE);
+    }
+    tcache_entry* tce = tbl[texture_id];
+    if (external_tce(tce) && __atomic_load_n(&tce->trimmed, __ATOMIC_ACQUIRE)) {
+        *trim = tce->trim_rect;
+        *full_w = tce->full_w;
+        *full_h = tce->full_h;
+        return true;
+    }
+    return false;
+}
+
 void tcache_dump() {
     static tcache_entry* stbl[HASHTPRIME];
     {
@@ -653,7 +1505,7 @@ void tcache_dump() {
         for(int ix=0; ix < HASHTPRIME; ++ix) {
             tcache_entry* tce = tbl[ix];
             if (tce && tce != tce_deleted) {
-                printf("    %05d) delta=%4d hashv=%08x inuse=%016x %s tce=%p surface:%p texture=%p w=%4d h=%4d bytes=%8d %s\n",
+                printf("    %05d) delta=%4d hashv=%08x inuse=%016x %s tce=%p surface:%p texture=%p w=%4d h=%4d bytes=%8d mips=%d %s %s\n",
                        ix, ix - last_ix,
                        tce->hashv,
                        tce->lru_count,
@@ -664,6 +1516,8 @@ void tcache_dump() {
                        tce->w,
                        tce->h,
                        tce->num_bytes,
+                       tce->num_mips,
+                       tce->opaque ? "opaque" : "alpha ",
                        tce->path);
                 ++count;
                 last_ix = ix;
@@ -709,6 +1563,19 @@ void tcache_dump() {
                 locked_texture_bytes, (float)locked_texture_bytes/(1024*1024),
                 unlocked_texture_bytes, (float)unlocked_texture_bytes/(1024*1024),
                 ejected_texture_bytes, (float)ejected_texture_bytes/(1024*1024));
+        tcache_pool_stats stats;
+        tcache_get_pool_stats(&stats);
+        unsigned lookups = stats.hits + stats.misses;
+        printf("Retired entries awaiting reclamation = %u, epoch=%lu\n", retired_count, (unsigned long)global_epoch);
+        printf("Texture limit = %u %s, allocation ceiling=%u, working set=%u %f MiB window=%u frames\n",
+                max_num_texture_bytes, auto_limit ? "auto": "fixed",
+                alloc_ceiling,
+                working_set_bytes, (float)working_set_bytes/(1024*1024), working_set_window);
+        printf("Texture pool: pooled=%u %f MiB, hits=%u misses=%u hit rate=%.1f%% destroyed=%u saved=%ld usec\n",
+                stats.pooled_bytes, (float)stats.pooled_bytes/(1024*1024),
+                stats.hits, stats.misses,
+                lookups ? (100.0f * stats.hits)/lookups : 0.0f,
+                stats.destroyed, stats.saved_usecs);
     }
     printf("-----------------------------\n");
 }
@@ -732,10 +1599,12 @@ bool tcache_lock_texture(texture_id_t texture_id) {
         error_printf("tcache_lock_texture: invalid id %d\n", texture_id);
         exit(EXIT_FAILURE);
     }
-    tcache_entry* tce = tbl[texture_id];
+    epoch_enter();
+    tcache_entry* tce = __atomic_load_n(tbl + texture_id, __ATOMIC_ACQUIRE);
     if (external_tce(tce)) {
         tce->locked = true;
     }
+    epoch_exit();
     return external_tce(tce);
 }
 
@@ -745,10 +1614,12 @@ bool tcache_unlock_texture(texture_id_t texture_id) {
         error_printf("tcache_unlock_texture: invalid id %d\n", texture_id);
         exit(EXIT_FAILURE);
     }
-    tcache_entry* tce = tbl[texture_id];
+    epoch_enter();
+    tcache_entry* tce = __atomic_load_n(tbl + texture_id, __ATOMIC_ACQUIRE);
     if (external_tce(tce)) {
         tce->locked = false;
     }
+    epoch_exit();
     return external_tce(tce);
 }
 
@@ -758,19 +1629,23 @@ bool tcache_unlock_texture(texture_id_t texture_id) {
 texture_id_t tcache_get_texture_id(const char* token) {
     uint32_t hashv = hashfn(token);
     texture_id_t indx = hashv%HASHTPRIME;
+    texture_id_t texture_id = INVALID_TEXTURE_ID;
 
+    epoch_enter();
     for(int count=0; count < HASHTPRIME; ++count, ++indx) {
-        tcache_entry* tce = tbl[indx];
+        tcache_entry* tce = __atomic_load_n(tbl + indx, __ATOMIC_ACQUIRE);
         if (!unoccupied_tce(tce) && (tce->hashv == hashv && 0 == compare_tce_paths(token,  tce->path))) {
             if (indx == 0) {
                 error_printf("tcache_get_texture_id: internal error: matched with texture id 0\n");
                 // bug in texture cache.
                 exit(EXIT_FAILURE);
             }
-            return indx;
+            texture_id = indx;
+            break;
         }
     }
-    return INVALID_TEXTURE_ID;
+    epoch_exit();
+    return texture_id;
 }
 
 static void _tcache_flush_textures(SDL_Renderer* renderer) {
@@ -778,11 +1653,6 @@ static void _tcache_flush_textures(SDL_Renderer* renderer) {
     // When deletes are performed the delete done counter is synchronised with the req counter
     // since *all* deletes are performed.
     if (delete_requested) {
-        // don't block on failure to acquire the lock, just return
-        if (!tcache_lock_try(&delete_lock)) {
-            return;
-        }
-
         int64_t ms_0 = get_micro_seconds();
         // BEFORE deleting, clear the delete_requested flag,
         // then if another thread requests a texture delete during the scan of cached entries
@@ -796,14 +1666,40 @@ static void _tcache_flush_textures(SDL_Renderer* renderer) {
         // texture_id 0 is the "unintialised" entry, skip it
         for(texture_id_t texture_id=0+1; texture_id < HASHTPRIME; ++texture_id) {
             tcache_entry* tce = tbl[texture_id];
-            if (tce && tce->delete) {
-                _delete_texture(texture_id);
+            if (external_tce(tce)) {
+                // a delete request cancelled concurrently is not deleted.
+                uint8_t state = TCE_DELETE_REQUESTED;
+                if (__atomic_compare_exchange_n(&tce->delete, &state, TCE_DELETING, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    _delete_texture(texture_id);
+                }
             }
         }
         int64_t ms_1 = get_micro_seconds();
         profile_texture_printf("texture_flush: %06lu usec\n", ms_1 - ms_0);
+    }
+    if (retired_list) {
+        reclaim_retired(false);
+    }
+}
 
-        tcache_unlock(&delete_lock);
+void tcache_set_scale_mode(SDL_ScaleMode mode) {
+    if (!check_permitted() || mode == scale_mode) {
+        return;
+    }
+    scale_mode = mode;
+    for(int ix=1; ix < HASHTPRIME; ++ix) {
+        tcache_entry* tce = tbl[ix];
+        if (!external_tce(tce)) {
+            continue;
+        }
+        if (tce->texture) {
+            SDL_SetTextureScaleMode((SDL_Texture*)tce->texture, mode);
+        }
+        for(int level=0; level < tce->num_mips; ++level) {
+            if (tce->mips[level].texture) {
+                SDL_SetTextureScaleMode((SDL_Texture*)tce->mips[level].texture, mode);
+            }
+        }
     }
 }
 
@@ -814,6 +1710,54 @@ void tcache_flush_textures(SDL_Renderer* renderer) {
     _tcache_flush_textures(renderer);
 }
 
+// Estimate the working set and set the cache limit just above it.
+// The window is the 90th percentile reuse distance, the working set is the
+// bytes of the entries used within that window.
+static void tcache_update_working_set(void) {
+    unsigned total = 0;
+    for(int ix=0; ix < TCACHE_REUSE_BUCKETS; ++ix) {
+        total += reuse_hist[ix];
+    }
+    if (total == 0) {
+        // no reuse observed yet, the working set is unknown
+        return;
+    }
+    unsigned acc = 0;
+    int bucket = 0;
+    for(; bucket < TCACHE_REUSE_BUCKETS-1; ++bucket) {
+        acc += reuse_hist[bucket];
+        if (acc * 10 >= total * 9) {
+            break;
+        }
+    }
+    working_set_window = 2u << bucket;
+    unsigned ws = 0;
+    for(int ix=1; ix < HASHTPRIME; ++ix) {
+        tcache_entry* tce = tbl[ix];
+        if (external_tce(tce) && lru_counter - tce->lru_count <= working_set_window) {
+            ws += tce->ws_bytes;
+        }
+    }
+    // external textures are always in use
+    ws += num_external_bytes;
+    working_set_bytes = ws;
+    // age the histogram so that the estimate follows changes in usage
+    for(int ix=0; ix < TCACHE_REUSE_BUCKETS; ++ix) {
+        reuse_hist[ix] -= reuse_hist[ix]/4;
+    }
+    if (auto_limit) {
+        unsigned limit = MAX(ws + ws/8, TCACHE_WS_MIN_BYTES);
+        if (alloc_ceiling) {
+            limit = MIN(limit, alloc_ceiling);
+        }
+        if (limit != max_num_texture_bytes) {
+            tcache_printf("tcache_update_working_set: window=%u frames ws=%u limit %u -> %u\n",
+                    working_set_window, ws, max_num_texture_bytes, limit);
+            max_num_texture_bytes = limit;
+        }
+    }
+}
+
 // texture cache prep for render must be called by the render thread,
 // before each frame render.
 void tcache_render_prep(SDL_Renderer* renderer) {
@@ -828,6 +1772,9 @@ void tcache_render_prep(SDL_Renderer* renderer) {
 //    int64_t ms_sort_0 = get_micro_seconds();
     lru_eject.count = lru_sort_tce(lru_eject.tbl);
     lru_eject.ix = 0;
+    if (lru_counter % TCACHE_WS_INTERVAL == 0) {
+        tcache_update_working_set();
+    }
 //    int64_t ms_sort_1 = get_micro_seconds();
 //    profile_texture_printf("lru_sort_tcache: %06lu\n", ms_sort_1 - ms_sort_0);
 }
@@ -841,30 +1788,141 @@ bool tcache_quick_get_texture_dimensions(texture_id_t texture_id, int* w, int* h
         error_printf("tcache_quick_get_texture_ejected: invalid id %d\n", texture_id);
         exit(EXIT_FAILURE);
     }
-    tcache_entry* tce = tbl[texture_id];
+    epoch_enter();
+    tcache_entry* tce = __atomic_load_n(tbl + texture_id, __ATOMIC_ACQUIRE);
+    bool rv = false;
     if (!unoccupied_tce(tce)) {
-        if (tce->texture || tce->surface) {
+        if (__atomic_load_n(&tce->trimmed, __ATOMIC_ACQUIRE)) {
+            *w = tce->full_w;
+            *h = tce->full_h;
+        } else if (tce->texture || tce->surface) {
             *w = tce->w;
             *h = tce->h;
         }
-        return true;
+        rv = true;
     }
-    return false;
+    epoch_exit();
+    return rv;
 }
 
 void tcache_set_limit(unsigned limit) {
     max_num_texture_bytes = limit;
+    auto_limit = false;
+}
+
+// The cache limit is set from the working set estimate,
+// capped by the texture memory the renderer can allocate.
+void tcache_set_auto_limit(void) {
+    auto_limit = true;
+    max_num_texture_bytes = alloc_ceiling;
+}
+
+bool tcache_get_auto_limit(void) {
+    return auto_limit;
+}
+
+unsigned tcache_get_limit(void) {
+    return max_num_texture_bytes;
+}
+
+unsigned tcache_get_working_set_bytes(void) {
+    return working_set_bytes;
+}
+
+// Textures created outside the cache count against the limit,
+// cached textures are ejected on subsequent uploads to make room.
+void tcache_add_external_bytes(int num_bytes) {
+    if (!check_permitted()) {
+        return;
+    }
+    num_external_bytes += num_bytes;
+    num_texture_bytes += num_bytes;
+}
+
+// Find how much texture memory the renderer can allocate, by creating
+// textures until creation fails or max_bytes is reached.
+// Textures of the software renderer, and of GPUs sharing system memory,
+// are ordinary RAM: the probe is skipped for the software renderer and
+// bounded by a quarter of the available RAM. Pixels are not uploaded,
+// drivers which defer allocation make the probe an over estimate that
+// allocation failures correct.
+// Returns the allocated bytes, three quarters of which is used as
+// the allocation ceiling, leaving headroom for the renderer.
+unsigned tcache_probe_texture_memory(SDL_Renderer* renderer, unsigned max_bytes) {
+    if (!check_permitted()) {
+        return 0;
+    }
+    SDL_RendererInfo info;
+    if (0 == SDL_GetRendererInfo(renderer, &info) && (info.flags & SDL_RENDERER_SOFTWARE)) {
+        printf("Texture memory probe: skipped for the software renderer\n");
+        return 0;
+    }
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0) {
+        uint64_t ram_bound = (uint64_t)pages * page_size / 4;
+        if (ram_bound < max_bytes) {
+            max_bytes = (unsigned)ram_bound;
+        }
+    }
+    const int dim = 1024;
+    const unsigned bytes = 4 * dim * dim;
+    SDL_Texture** textures = calloc(max_bytes/bytes + 1, sizeof(SDL_Texture*));
+    if (textures == NULL) {
+        error_printf("tcache_probe_texture_memory: Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    int64_t ms_0 = get_micro_seconds();
+    unsigned count = 0;
+    unsigned probed = 0;
+    while (probed + bytes <= max_bytes) {
+        SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, dim, dim);
+        if (texture == NULL) {
+            break;
+        }
+        textures[count++] = texture;
+        probed += bytes;
+    }
+    SDL_ClearError();
+    for(unsigned ix=0; ix < count; ++ix) {
+        SDL_DestroyTexture(textures[ix]);
+    }
+    free(textures);
+    int64_t ms_1 = get_micro_seconds();
+    alloc_ceiling = probed - probed/4;
+    if (auto_limit) {
+        max_num_texture_bytes = alloc_ceiling;
+    }
+    printf("Texture memory probe: %u bytes %f MiB allocatable, ceiling=%u, %ld usec\n",
+            probed, (float)probed/(1024*1024), alloc_ceiling, ms_1 - ms_0);
+    return probed;
 }
 
 void tcache_shutdown(void) {
+    if (check_permitted()) {
+        for(int ix=0; ix < TCACHE_POOL_SIZE; ++ix) {
+            if (pool[ix].texture) {
+                pool_destroy(ix);
+            }
+        }
+    }
     for(texture_id_t texture_id=0+1; texture_id < HASHTPRIME; ++texture_id) {
         tcache_entry* tce = tbl[texture_id];
-        if (tce && tce->surface) {
-            if(check_permitted()) {
-                _delete_texture(texture_id);
+        if (!external_tce(tce)) {
+            continue;
+        }
+        if(check_permitted()) {
+            _delete_texture(texture_id);
+        } else {
+            free_mip_surfaces(tce);
+            if (tce->surface) {
+                SDL_FreeSurface(tce->surface);
+                tce->surface = NULL;
             }
-            SDL_FreeSurface(tce->surface);
-            tce->surface = NULL;
         }
     }
+    // all texture cache activity has ceased, no thread can be accessing entries.
+    if(check_permitted()) {
+        reclaim_retired(true);
+    }
 }
@@ -7,6 +7,8 @@ typedef int  texture_id_t;
 
 void tcache_init(void);
 void tcache_set_renderer_tid(const SDL_threadID);
+// any thread, call before a thread which used the texture cache exits
+void tcache_thread_exit(void);
 // Note: tcache_shutdown is not thread safe, must be called 
 // after ceasing all texture cache activity to release resources
 void tcache_shutdown(void);
@@ -14,10 +16,18 @@ void tcache_shutdown(void);
 // { These functions must be called in the thread that created the renderer
 void tcache_flush_textures(SDL_Renderer* renderer);
 SDL_Texture* tcache_get_texture(const char* token, texture_id_t* texture_id, SDL_Renderer* renderer);
-SDL_Texture* tcache_quick_get_texture(texture_id_t texture_id, SDL_Renderer* renderer);
+// dst_rect: destination size the texture will be drawn at, used to select
+//           a downscaled (mip) level, NULL selects the full size texture.
+// src_rect: optional, on entry the source rect in full size texture coordinates,
+//           on return the source rect scaled to the selected level.
+SDL_Texture* tcache_quick_get_texture(texture_id_t texture_id, SDL_Renderer* renderer, const SDL_Rect* dst_rect, SDL_Rect* src_rect);
 bool tcache_quick_get_texture_ejected(texture_id_t texture_id);
+bool tcache_quick_get_texture_opaque(texture_id_t texture_id);
+bool tcache_quick_get_texture_trim(texture_id_t texture_id, SDL_Rect* trim, int* full_w, int* full_h);
 void tcache_render_prep(SDL_Renderer* renderer);
 
+unsigned tcache_probe_texture_memory(SDL_Renderer* renderer, unsigned max_bytes);
+
 // Test only function
 bool tcache_test_lru_eject();
 // }
@@ -26,6 +36,8 @@ bool tcache_test_lru_eject();
 texture_id_t tcache_create_entry(const char* path);
 bool tcache_load_from_file(texture_id_t texture_id, SDL_Renderer* renderer);
 texture_id_t tcache_load_media(const char* path, SDL_Renderer* renderer, bool* loaded);
+texture_id_t tcache_load_sprite(const char* path, SDL_Renderer* renderer, bool* loaded);
+bool tcache_set_trim(texture_id_t texture_id);
 bool tcache_set_surface(texture_id_t texture_id, SDL_Surface* surface);
 
 bool tcache_lock_texture(texture_id_t texture_id);
@@ -36,9 +48,35 @@ texture_id_t tcache_get_texture_id(const char* token);
 
 bool tcache_quick_get_texture_dimensions(texture_id_t texture_id, int* w, int* h);
 
+typedef struct {
+    // uploads which reused a pooled texture
+    unsigned    hits;
+    // uploads which created a new texture
+    unsigned    misses;
+    // released textures destroyed instead of pooled
+    unsigned    destroyed;
+    unsigned    pooled_bytes;
+    int64_t     create_usecs;
+    int64_t     update_usecs;
+    // estimated time saved by reusing pooled textures
+    int64_t     saved_usecs;
+} tcache_pool_stats;
+
 unsigned tcache_get_texture_bytes_count(void);
 unsigned tcache_get_surface_bytes_count(void);
 void tcache_set_limit(unsigned);
+void tcache_set_auto_limit(void);
+bool tcache_get_auto_limit(void);
+unsigned tcache_get_limit(void);
+unsigned tcache_get_working_set_bytes(void);
+// render thread, num_bytes of a texture created (> 0) or destroyed (< 0)
+// outside the cache
+void tcache_add_external_bytes(int num_bytes);
+// render thread, applies to resident and future textures
+void tcache_set_scale_mode(SDL_ScaleMode mode);
+// render thread, hook is called before a texture is pooled or destroyed,
+// NULL hook => none
+void tcache_set_release_hook(void (*hook)(void*), void* context);
 
 // These functions can be called by any thread, but actions
 // may be deferred to the render thread.
@@ -47,5 +85,7 @@ bool tcache_delete_texture(const char* token);
 
 // Diagnostics
 void tcache_dump();
+// texture pool statistics, should be called in the render thread
+void tcache_get_pool_stats(tcache_pool_stats* stats);
 
 #endif // __jl_texture_h_
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <time.h>
+#include <errno.h>
 
 
 int64_t get_micro_seconds() {
@@ -37,3 +38,10 @@ void sleep_micro_seconds(int64_t micros) {
     struct timespec ts = {.tv_sec =0, .tv_nsec = 1000*micros};
     nanosleep(&ts, NULL);
 }
+
+void sleep_until_micro_seconds(int64_t deadline) {
+    struct timespec ts = {.tv_sec = deadline/1000000, .tv_nsec = (deadline%1000000)*1000};
+    // absolute time, so restarting after a signal does not extend the sleep
+    while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)) {
+    }
+}
@@ -6,4 +6,6 @@ int64_t get_micro_seconds();
 int64_t get_milli_seconds();
 void sleep_milli_seconds(int64_t millis);
 void sleep_micro_seconds(int64_t micros);
+// sleep until the absolute get_micro_seconds() time deadline
+void sleep_until_micro_seconds(int64_t deadline);
 #endif // __jl_timing_h_
@@ -143,6 +143,13 @@ void setup_orientation(float orientation, int w, int h, SDL_Rect *screen) {
     }
 }
 
+// Widgets are drawn unrotated, input coordinates are still translated.
+// Used when the scene is rotated once when presented.
+void setup_unrotated_rendering(void) {
+    translate_image_rect = xlate_image_rect_0;
+    translate_draw_rect = xlate_draw_rect_0;
+}
+
 void rebaseRect(SDL_Rect* origin, SDL_Rect* src, SDL_Rect* dst) {
     dst->x = origin->x + src->x;
     dst->y = origin->y + src->y;
@@ -8,6 +8,7 @@ extern const void (*translate_point)(SDL_Point* pt);
 extern const void (*translate_image_rect)(SDL_Rect* rect);
 extern const void (*translate_draw_rect)(SDL_Rect* rect);
 extern void setup_orientation(float orientation, int w, int h, SDL_Rect* screen);
+extern void setup_unrotated_rendering(void);
 
 extern void copyRect(const SDL_Rect *src, SDL_Rect *dst);
 void rebaseRect(SDL_Rect* origin, SDL_Rect* src, SDL_Rect* dst);
@@ -21,8 +21,45 @@ static long long RMS_MAP[] = {
 
 extern void (*vol_printf)(char *format, ...);
 
-int visualizer_vumeter(int* levels) {
+// deterministic levels for benchmarking, advanced once per frame
+static bool synthetic;
+static unsigned synthetic_frame;
+
+void visualizer_vumeter_synthetic(bool on) {
+	synthetic = on;
+	synthetic_frame = 0;
+}
+
+void visualizer_vumeter_synthetic_step(void) {
+	++synthetic_frame;
+}
+
+// triangle waves of different periods per channel, with some
+// pseudo random ripple so that needles and peaks keep moving
+static void synthetic_levels(int* levels) {
+	static const unsigned periods[2] = {97, 61};
+	for (int ch = 0; ch < 2; ++ch) {
+		unsigned phase = synthetic_frame % periods[ch];
+		unsigned half = periods[ch] / 2;
+		int level = (phase < half ? phase : periods[ch] - phase) * 45 / half;
+		unsigned ripple = (synthetic_frame * 1103515245u + 12345u + ch) >> 16;
+		level += ripple % 5;
+		levels[ch] = level > 49 ? 49 : level;
+	}
+}
+
+static inline int rms_level(long long mean_square) {
+	for (int level = 49; level >= 0; --level) {
+		if (mean_square > RMS_MAP[level]) {
+			return level;
+		}
+	}
+	return 0;
+}
+
+static void vumeter_analyse(vis_snapshot* snap) {
 	long long sample_accumulator[2];
+	long long sample_peak[2];
 	int16_t *ptr;
 	s16_t sample;
 	s32_t sample_sq;
@@ -30,10 +67,20 @@ int visualizer_vumeter(int* levels) {
 
 	int offs;
 
+	if (synthetic) {
+		synthetic_levels(snap->levels);
+		for (int ch = 0; ch < 2; ++ch) {
+			snap->peaks[ch] = snap->levels[ch] + 3 > 49 ? 49 : snap->levels[ch] + 3;
+		}
+		return;
+	}
+
 	num_samples = VUMETER_DEFAULT_SAMPLE_WINDOW;
 
 	sample_accumulator[0] = 0;
 	sample_accumulator[1] = 0;
+	sample_peak[0] = 0;
+	sample_peak[1] = 0;
 
 	vis_check();
 
@@ -51,10 +98,12 @@ int visualizer_vumeter(int* levels) {
 			sample = (*ptr++) >> 8;
 			sample_sq = sample * sample;
 			sample_accumulator[0] += sample_sq;
+			if (sample_sq > sample_peak[0]) sample_peak[0] = sample_sq;
 
 			sample = (*ptr++) >> 8;
 			sample_sq = sample * sample;
 			sample_accumulator[1] += sample_sq;
+			if (sample_sq > sample_peak[1]) sample_peak[1] = sample_sq;
 
 			samples_until_wrap -= 2;
 			if (samples_until_wrap <= 0) {
@@ -71,16 +120,25 @@ int visualizer_vumeter(int* levels) {
 //    printf("%08lld %08lld ", sample_accumulator[0], sample_accumulator[1]);
 
     for(int indx =0; indx < 2; ++indx) {
-        levels[indx] = 0;
-        for (int level = 49; level >=0; --level) {
-            if (sample_accumulator[indx] > RMS_MAP[level]) {
-                levels[indx] = level;
-//                vol_printf("%02d %08lld %08lld ", level, sample_accumulator[indx], RMS_MAP[level]);
-                vol_printf("%02d %08lld %08lld ", level, sample_accumulator[indx], RMS_MAP[level]);
-                break;
-            }
+        snap->levels[indx] = rms_level(sample_accumulator[indx]);
+        // peak sample on the same scale as the levels
+        snap->peaks[indx] = rms_level(sample_peak[indx]);
+        if (snap->levels[indx]) {
+            vol_printf("%02d %08lld %08lld ", snap->levels[indx], sample_accumulator[indx], RMS_MAP[snap->levels[indx]]);
         }
     }
+}
+
+// render thread only, every consumer in a frame sees the same analysis
+static vis_snapshot snapshot;
+
+const vis_snapshot* visualizer_snapshot_update(int64_t timestamp) {
+	vumeter_analyse(&snapshot);
+	snapshot.timestamp = timestamp;
+	++snapshot.frame;
+	return &snapshot;
+}
 
-	return 1;
+const vis_snapshot* visualizer_snapshot(void) {
+	return &snapshot;
 }
@@ -1,7 +1,18 @@
 #ifndef __jl_visualiser_h
 #define __jl_visualiser_h
+#include <stdint.h>
 #include "types.h"
 
+// audio analysis for one frame
+typedef struct {
+    // get_micro_seconds() at the start of the frame
+    int64_t timestamp;
+    unsigned frame;
+    // rms and peak levels per channel, 0 to 49
+    int levels[2];
+    int peaks[2];
+} vis_snapshot;
+
 extern void vis_check(void);
 extern void vis_lock(void);
 extern void vis_unlock(void);
@@ -12,6 +23,11 @@ extern u32_t vis_get_rate(void);
 extern s16_t *vis_get_buffer(void);
 extern u32_t vis_get_buffer_len(void);
 extern u32_t vis_get_buffer_idx(void);
-extern int visualizer_vumeter(int* levels);
+// render thread, analyse once at the start of each frame
+extern const vis_snapshot* visualizer_snapshot_update(int64_t timestamp);
+// the snapshot of the current frame
+extern const vis_snapshot* visualizer_snapshot(void);
+extern void visualizer_vumeter_synthetic(bool on);
+extern void visualizer_vumeter_synthetic_step(void);
 #endif //__jl_visualiser_h
 
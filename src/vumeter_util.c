@@ -12,6 +12,8 @@
 #include "visualizer.h"
 #include "util.h"
 #include "timing.h"
+#include "draw_stats.h"
+#include "render_batch.h"
 
 // @60 FPS 30 => 1/2 a second
 static int peak_hold_counter_init_value = 30;
@@ -32,6 +34,17 @@ void VUMeter_set_decay_hold(int decay_hold) {
     decay_hold_counter_init_value = decay_hold;
 }
 
+// Hold and decay are defined in frames at 60 frames per second, and
+// advance by the time between draws of the meter, independent of the
+// display refresh and the draw rate.
+#define VU_TICK_USECS (1000000/60)
+
+// unlit segments are not drawn when rendering is degraded
+static bool skip_off_segments;
+void VUMeter_skip_off_segments(bool skip) {
+    skip_off_segments = skip;
+}
+
 
 static void center_vu_element(SDL_Rect* outer, SDL_Rect* inner, SDL_Rect* dst, float orientation) {
     int dx = (outer->w - inner->w)/2;
@@ -112,6 +125,11 @@ void VUMeter_orientate(vumeter_properties *vu, float rotation, SDL_Rect* enclosu
             center_vu_element(enclosure, &rbs, &ve->rect, 270.0);
         }
     }
+    // placements do not move once orientated
+    vumeter_element *ve = vu->placements.elements;
+    for(indx = 0; indx < vu->placements.count; ++indx, ++ve) {
+        rebaseRect(enclosure, &ve->rect, &ve->screen_rect);
+    }
 }
 
 static char load_buffer[4096];
@@ -138,7 +156,7 @@ SDL_bool VUMeter_load_media(SDL_Renderer *renderer, vumeter_properties *vu) {
                     exit(EXIT_FAILURE);
                 }
                 bool loaded = false;
-                vu->resources.textures[indx] = tcache_load_media(load_buffer, renderer, &loaded);
+                vu->resources.textures[indx] = tcache_load_sprite(load_buffer, renderer, &loaded);
                 ok = ok && loaded;
             } else {
                 // if no texture is associated with a slot point to the empty entry, this 
@@ -341,7 +359,6 @@ vumeter_properties* VUMeter_scale(vumeter_properties* vu, int w_in, int h_in, fl
     return resized_vu;
 }
 
-static SDL_RendererFlip flip = SDL_FLIP_NONE;
 static uint64_t frame_count;
 static uint32_t sample_frame_count;
 static int64_t acc_render_time;
@@ -352,8 +369,84 @@ static int64_t ms_2;
 static const vumeter* prev_vumeter;
 
 
-void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter* vumeter, int* vols, SDL_Rect* enclosure) {
-//    SDL_RenderClear(renderer);
+// elements of a meter are gathered and drawn in as few calls as possible
+static render_batch batch;
+
+// Sprites trimmed of transparent borders are drawn into the matching
+// part of the placement rect, returns false for untrimmed sprites.
+static inline bool trimmed_rect(texture_id_t texture_id, const SDL_Rect* rect, SDL_Rect* dst_rect) {
+    SDL_Rect trim;
+    int full_w, full_h;
+    if (!tcache_quick_get_texture_trim(texture_id, &trim, &full_w, &full_h)) {
+        return false;
+    }
+    dst_rect->x = rect->x + (trim.x * rect->w)/full_w;
+    dst_rect->y = rect->y + (trim.y * rect->h)/full_h;
+    dst_rect->w = (trim.w * rect->w + full_w - 1)/full_w;
+    dst_rect->h = (trim.h * rect->h + full_h - 1)/full_h;
+    return true;
+}
+
+// Draw an element texture, trimmed sprites are rotated about the centre
+// of the placement rect.
+static inline void render_element(SDL_Renderer *renderer, texture_id_t texture_id, SDL_Rect* rect, double rotation) {
+    SDL_Rect dst_rect;
+    if (trimmed_rect(texture_id, rect, &dst_rect)) {
+        SDL_Point centre = {
+            .x = rect->x + rect->w/2 - dst_rect.x,
+            .y = rect->y + rect->h/2 - dst_rect.y,
+        };
+        render_batch_copy_ex(&batch,
+                tcache_quick_get_texture(texture_id, renderer, &dst_rect, NULL),
+                NULL, &dst_rect, rotation, rotation == 0 ? NULL : &centre);
+    } else {
+        render_batch_copy_ex(&batch,
+                tcache_quick_get_texture(texture_id, renderer, rect, NULL),
+                NULL, rect, rotation, NULL);
+    }
+}
+
+bool VUMeter_opaque_rect(const vumeter_properties *vu, const vumeter* vumeter, SDL_Rect* rect) {
+    int area = 0;
+    if (vumeter->background == NULL) {
+        return false;
+    }
+    for (const int *bg = vumeter->background->bg; bg != NULL && 0 != *bg; ++bg) {
+        const vumeter_element *p = &vu->placements.elements[*bg];
+        texture_id_t texture_id = vu->resources.textures[p->texture_index];
+        // opacity is of the trimmed texture, the edges of a scaled trimmed
+        // rect are rounded outwards, so inset by a pixel.
+        SDL_Rect r;
+        if (trimmed_rect(texture_id, &p->screen_rect, &r)) {
+            r.x += 1;
+            r.y += 1;
+            r.w -= 2;
+            r.h -= 2;
+        } else {
+            copyRect(&p->screen_rect, &r);
+        }
+        if (r.w <= 0 || r.h <= 0) {
+            continue;
+        }
+        if (r.w * r.h > area && tcache_quick_get_texture_opaque(texture_id)) {
+            area = r.w * r.h;
+            copyRect(&r, rect);
+        }
+    }
+    if (area && (vu->rotation == 90.0 || vu->rotation == 270.0)) {
+        // elements are rotated about their centre
+        SDL_Rect r;
+        copyRect(rect, &r);
+        rect->x = r.x + (r.w - r.h)/2;
+        rect->y = r.y + (r.h - r.w)/2;
+        rect->w = r.h;
+        rect->h = r.w;
+    }
+    return area != 0;
+}
+
+void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter* vumeter, int* vols) {
+//    draw_clear(renderer);
 
     if (perf_printf != dummy_printf) {
        if(prev_vumeter != vumeter) {
@@ -378,24 +471,39 @@ void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter*
     runtimes[0]->vol = vols[0];
     runtimes[1]->vol = vols[1];
 
-    SDL_Rect render_rect;
+    int64_t now = visualizer_snapshot()->timestamp;
+
+    render_batch_begin(&batch, renderer);
+    // texture lookups may eject or replace textures already in the batch
+    tcache_set_release_hook(render_batch_release, &batch);
 
     for (i=0; i < 2; ++i) {
+        // a meter drawn more than once in a frame, for several damaged
+        // regions, advances once, the first draw advances a frame,
+        // clamped to a second after a long absence
+        int64_t elapsed = runtimes[i]->timestamp ? now - runtimes[i]->timestamp : VU_TICK_USECS;
+        elapsed = elapsed < 0 ? 0 : elapsed > 1000000 ? 1000000 : elapsed;
+        runtimes[i]->timestamp = now;
         if (runtimes[i]->vol > runtimes[i]->peak_hold_vol) {
 //            runtimes[i].peak_hold_counter = peak_hold_counter_start;
-            runtimes[i]->peak_hold_counter = peak_hold_counter_init_value;
+            runtimes[i]->peak_hold_counter = peak_hold_counter_init_value * VU_TICK_USECS;
             runtimes[i]->peak_hold_vol = runtimes[i]->vol;
         }
-        if (--runtimes[i]->peak_hold_counter < 0) {
+        runtimes[i]->peak_hold_counter -= elapsed;
+        if (runtimes[i]->peak_hold_counter < 0) {
             runtimes[i]->peak_hold_vol = 0;
             runtimes[i]->peak_hold_counter = 0;
         }
         if (runtimes[i]->vol > runtimes[i]->decay_vol) {
             runtimes[i]->decay_vol = runtimes[i]->vol;
-            runtimes[i]->decay_hold_counter = decay_hold_counter_init_value;
+            runtimes[i]->decay_hold_counter = decay_hold_counter_init_value * VU_TICK_USECS;
         } else {
-            if (--runtimes[i]->decay_hold_counter < 0) {
-                runtimes[i]->decay_vol -= runtimes[i]->decay_unit;
+            runtimes[i]->decay_hold_counter -= elapsed;
+            if (runtimes[i]->decay_hold_counter < 0) {
+                runtimes[i]->decay_vol -= runtimes[i]->decay_unit * elapsed / VU_TICK_USECS;
+                if (runtimes[i]->decay_vol < 0) {
+                    runtimes[i]->decay_vol = 0;
+                }
                 runtimes[i]->decay_hold_counter = 0;
             }
         }
@@ -405,21 +513,16 @@ void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter*
         const int *bg = vumeter->background->bg;
         while(bg != NULL && 0 != *bg) {
             vumeter_element *p = &vu->placements.elements[*bg];
-            rebaseRect(enclosure, &p->rect, &render_rect);
-            SDL_RenderCopyEx(renderer,
-                    tcache_quick_get_texture(vu->resources.textures[p->texture_index], renderer),
-                    NULL, &render_rect, vu->rotation, NULL, flip);
+            render_element(renderer, vu->resources.textures[p->texture_index], &p->screen_rect, vu->rotation);
             ++bg;
         }
     }
 
 #define _RENDER_VOLUME_LEVEL_(value) \
-        rebaseRect(enclosure, &vu->placements.elements[comp->placements[value]].rect, &render_rect); \
-        SDL_RenderCopyEx(renderer,\
-        tcache_quick_get_texture(vu->resources.textures[vu->placements.elements[comp->placements[value]].texture_index], renderer),\
-        NULL,\
-        &render_rect,\
-        vu->rotation, NULL, flip)
+        render_element(renderer,\
+        vu->resources.textures[vu->placements.elements[comp->placements[value]].texture_index],\
+        &vu->placements.elements[comp->placements[value]].screen_rect,\
+        vu->rotation)
 
     for(i=0; i<2; ++i) {
         vol_printf("%2d) ", i);
@@ -483,7 +586,7 @@ void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter*
                         }
                     }break;
                 case AGGREGATEOFF:
-                    {
+                    if (!skip_off_segments) {
                         int vol = 0;
                         switch(comp->peak) {
                             case PEAK_NONE:
@@ -504,6 +607,8 @@ void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter*
         }
     }
     vol_printf("\r");
+    render_batch_flush(&batch);
+    tcache_set_release_hook(NULL, NULL);
 
 #undef _RENDER_VOLUME_LEVEL_
     int64_t delta_pf = get_micro_seconds() - ms0;
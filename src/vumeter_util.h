@@ -18,7 +18,8 @@ void VUMeter_orientate(vumeter_properties *vu, float rotation, SDL_Rect* rect);
 SDL_bool VUMeter_load_media(SDL_Renderer *renderer, vumeter_properties *vu);
 void VUMeter_unload_media(vumeter_properties *vu);
 
-void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter* vumeter, int* vols, SDL_Rect* enclosure);
+// elements are drawn at the screen rects set by VUMeter_orientate
+void VUMeter_draw(SDL_Renderer *renderer, vumeter_properties *vu, const vumeter* vumeter, int* vols);
 
 void VUMeter_dump_props(const vumeter_properties* vu);
 
@@ -31,6 +32,10 @@ const vumeter_properties* VUMeter_get_props_list();
 
 void VUMeter_set_peak_hold(int peak_hold);
 void VUMeter_set_decay_hold(int decay_hold);
+void VUMeter_skip_off_segments(bool skip);
+// Screen footprint of the largest opaque background element,
+// returns false if the meter has none.
+bool VUMeter_opaque_rect(const vumeter_properties *vu, const vumeter* vumeter, SDL_Rect* rect);
 
 #endif  // __jl_vumeter_util_h_
 
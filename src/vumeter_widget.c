@@ -82,7 +82,7 @@ void vumeter_widget_load_media(widget *wdgt, const char* resource_path) {
         base_props->resource_path = VUMeter_resource_path(resource_path, base_props);
         vumeter_properties* props = VUMeter_scale(base_props,
                 wdgt->rect.w, wdgt->rect.h,
-                wdgt->view->app->orientation, buffer);
+                wdgt->view->app->render_orientation, buffer);
 #ifdef  VUMETERS_CHECK_ON_INIT
         if (!VUMeter_load_media(wdgt->view->app->renderer, props)) {
             error_printf("failed to load media for %s\n", props->name);
@@ -90,9 +90,8 @@ void vumeter_widget_load_media(widget *wdgt, const char* resource_path) {
         }
 #endif
         SDL_Rect draw_rect;
-        copyRect(&wdgt->rect, &draw_rect);
-        translate_draw_rect(&draw_rect);
-        VUMeter_orientate(props, wdgt->view->app->orientation, &draw_rect);
+        copyRect(&wdgt->draw_rect, &draw_rect);
+        VUMeter_orientate(props, wdgt->view->app->render_orientation, &draw_rect);
 #ifdef  VUMETERS_CHECK_ON_INIT
         VUMeter_unload_media(props);
 #endif
@@ -125,17 +124,16 @@ static void vumeter_render(widget* wdgt) {
         if (show_rects) { _show_draw_rect(wdgt); }
         if (show_input_rects) { _show_input_rect(wdgt); }
     }
-    SDL_Rect draw_rect;
-    copyRect(&wdgt->rect, &draw_rect);
-    translate_draw_rect(&draw_rect);
     vumeter_widget* vw = wdgt->sub.vu;
-    int vols[2];
-    visualizer_vumeter(vols);
-    if(vw->meters[vumeter_index(vw)].props->volume_levels != 49) {
-        vols[0] = vols[0] * vw->meters[vumeter_index(vw)].props->volume_levels/50;
-        vols[1] = vols[1] * vw->meters[vumeter_index(vw)].props->volume_levels/50;
+    const vis_snapshot* snap = visualizer_snapshot();
+    int vols[2] = {snap->levels[0], snap->levels[1]};
+    // the index is changed by the input thread, read it once per frame
+    int indx = vumeter_index(vw);
+    if(vw->meters[indx].props->volume_levels != 49) {
+        vols[0] = vols[0] * vw->meters[indx].props->volume_levels/50;
+        vols[1] = vols[1] * vw->meters[indx].props->volume_levels/50;
     }
-    VUMeter_draw(wdgt->view->app->renderer,vw->meters[vumeter_index(vw)].props,vw->meters[vumeter_index(vw)].meter, vols, &draw_rect);
+    VUMeter_draw(wdgt->view->app->renderer,vw->meters[indx].props,vw->meters[indx].meter, vols);
 }
 
 widget *widget_create_vumeter(const view_context* view) {
@@ -144,6 +142,8 @@ widget *widget_create_vumeter(const view_context* view) {
         wdgt->view = view;
         wdgt->action = ACTION_NONE;
         wdgt->render = vumeter_render;
+        // levels, peaks and decay change every frame
+        wdgt->animated = true;
         wdgt->sub.vu = calloc(1, sizeof(vumeter_widget));
         if (wdgt->sub.vu == NULL) {
             widget_destroy(wdgt);
@@ -248,6 +248,36 @@ widget *widget_vumeter_select_by_name(widget *wdgt, const char* name) {
     return wdgt;
 }
 
+widget *widget_vumeter_select_index(widget *wdgt, int indx) {
+    if (wdgt && wdgt->type == WIDGET_VUMETER) {
+        vumeter_select(wdgt, indx);
+    }
+    return wdgt;
+}
+
+int widget_vumeter_count(widget *wdgt) {
+    if (wdgt && wdgt->type == WIDGET_VUMETER) {
+        return wdgt->sub.vu->num_meters;
+    }
+    return 0;
+}
+
+const char* widget_vumeter_name(widget *wdgt) {
+    if (wdgt && wdgt->type == WIDGET_VUMETER && wdgt->sub.vu->num_meters) {
+        vumeter_widget* vw = wdgt->sub.vu;
+        return vw->meters[vumeter_index(vw)].meter->name;
+    }
+    return NULL;
+}
+
+bool widget_vumeter_opaque_rect(widget *wdgt, SDL_Rect* rect) {
+    if (wdgt && wdgt->type == WIDGET_VUMETER && wdgt->sub.vu->num_meters) {
+        vumeter_widget* vw = wdgt->sub.vu;
+        return VUMeter_opaque_rect(vw->meters[vumeter_index(vw)].props, vw->meters[vumeter_index(vw)].meter, rect);
+    }
+    return false;
+}
+
 widget *widget_vumeter_select_lock(widget *wdgt, bool lock) {
     vumeter_widget* vw = wdgt->sub.vu;
     vw->locked = lock;
@@ -13,6 +13,8 @@ typedef struct {
 //    const char* image;
     int         texture_index;
     SDL_Rect    rect;
+    // rect on screen, set by VUMeter_orientate
+    SDL_Rect    screen_rect;
     int         flip;
     struct {
         float       angle;
@@ -52,10 +54,13 @@ typedef struct {
 typedef struct {
     int vol;
     int peak_hold_vol;
+    // hold time remaining in microseconds
     int peak_hold_counter;
     int decay_hold_counter;
     float decay_vol;
     float decay_unit;
+    // visualizer snapshot timestamp of the previous draw
+    int64_t timestamp;
 }runtime_volume;
 
 typedef struct {
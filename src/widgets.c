@@ -3,9 +3,11 @@
 #include <SDL2/SDL_render.h>
 #include "application.h"
 #include "widgets.h"
+#include "draw_stats.h"
 #include "actions.h"
 #include "util.h"
 #include "logging.h"
+#include "timing.h"
 
 extern widget *vumeter_widget_destroy(widget *wdgt);
 extern void vumeter_widget_load_media(widget *wdgt, const char* resource_path);
@@ -16,6 +18,16 @@ bool show_input_rects = false;
 
 static SDL_RendererFlip flip = SDL_FLIP_NONE;
 
+// images are rotated by the screen orientation,
+// the plain copy is cheaper when there is nothing to rotate
+static inline int draw_widget_image(widget* wdgt, SDL_Texture* texture, const SDL_Rect* src_rect, const SDL_Rect* dst_rect) {
+    if (wdgt->view->app->render_orientation == 0 && flip == SDL_FLIP_NONE) {
+        return draw_copy(wdgt->view->app->renderer, texture, src_rect, dst_rect);
+    }
+    return draw_copy_ex(wdgt->view->app->renderer, texture, src_rect, dst_rect,
+            wdgt->view->app->render_orientation, NULL, flip);
+}
+
 static char* widget_type_strings[] = {
     "None",
     "Image",
@@ -29,6 +41,26 @@ static char* widget_type_strings[] = {
 static unsigned text_widget_id = 1;
 static void text_render_surface(widget* wdgt);
 
+// A run of consecutive static widgets, rendered once into a target texture
+// and re-rendered only when one of the widgets changes.
+struct widget_layer {
+    struct widget_layer* next;
+    widget*         first;
+    // inclusive
+    widget*         last;
+    SDL_Texture*    texture;
+    int             num_bytes;
+    // area drawn by the widgets when baked, only this is copied
+    SDL_Rect        bounds;
+    // the bottom layer is baked on black and copied without blending
+    bool            opaque;
+    bool            atomic_stale;
+};
+
+static inline void widget_layer_set_stale(widget_layer* layer) {
+    __atomic_store_n(&layer->atomic_stale, true, __ATOMIC_RELEASE);
+}
+
 static inline void free_ex(void** tgt) {
     if (*tgt) {
         free(*tgt);
@@ -44,7 +76,9 @@ bool widget_highlight(widget* wdgt) {
 }
 
 void widget_set_highlight(widget* wdgt, bool onoff) {
-     __atomic_store_n(&wdgt->atomic_highlight, onoff, __ATOMIC_RELEASE);
+    if (onoff != __atomic_exchange_n(&wdgt->atomic_highlight, onoff, __ATOMIC_ACQ_REL)) {
+        widget_set_dirty(wdgt);
+    }
 }
 
 bool widget_pressed(widget* wdgt) {
@@ -52,7 +86,55 @@ bool widget_pressed(widget* wdgt) {
 }
 
 void widget_set_pressed(widget* wdgt, bool onoff) {
-     __atomic_store_n(&wdgt->atomic_pressed, onoff, __ATOMIC_RELEASE);
+    if (onoff != __atomic_exchange_n(&wdgt->atomic_pressed, onoff, __ATOMIC_ACQ_REL)) {
+        widget_set_dirty(wdgt);
+    }
+}
+
+// Mark the widget for redraw, callable from any thread.
+// The state change must be stored before the widget is marked,
+// the render thread clears the mark before it draws the widget.
+void widget_set_dirty(widget* wdgt) {
+    // layers are created while the loader threads mark widgets loaded
+    widget_layer* layer = __atomic_load_n(&wdgt->layer, __ATOMIC_ACQUIRE);
+    if (layer) {
+        widget_layer_set_stale(layer);
+    }
+    __atomic_store_n(&wdgt->atomic_dirty, true, __ATOMIC_RELEASE);
+}
+
+static inline bool widget_take_dirty(widget* wdgt) {
+    return __atomic_exchange_n(&wdgt->atomic_dirty, false, __ATOMIC_ACQ_REL);
+}
+
+// Copy the published state of the widget to shown, render thread.
+// The render thread does not wait for writers: if a write is in progress
+// the previous state is kept and the widget is marked for the next frame.
+static void widget_take_state(widget* wdgt) {
+    widget_state state;
+    uint32_t seq;
+    if (seqlock_read_try(&wdgt->state_lock, &seq)) {
+        switch (wdgt->type) {
+            case WIDGET_SLIDER:
+                state.slider.current_pos = wdgt->sub.slider.wk.current_pos;
+                state.slider.drag_pos = wdgt->sub.slider.wk.drag_pos;
+                break;
+            case WIDGET_TEXT:
+                copyRect(&wdgt->sub.text.dst_rect, &state.text_rect);
+                break;
+            case WIDGET_MULTISTATE_BUTTON:
+                state.state = wdgt->sub.multistate_button.state;
+                break;
+            default:
+                return;
+        }
+        if (!seqlock_read_retry(&wdgt->state_lock, seq)) {
+            wdgt->shown = state;
+            wdgt->shown_seq = seq;
+            return;
+        }
+    }
+    widget_set_dirty(wdgt);
 }
 
 
@@ -68,22 +150,18 @@ void render_none(widget* btn) {
 
 void _debug_draw_rect(widget* wdgt) {
     if (wdgt) {
-        SDL_Rect draw_rect;
-        copyRect(&wdgt->rect, &draw_rect);
-        translate_draw_rect(&draw_rect);
+        const SDL_Rect* draw_rect = &wdgt->draw_rect;
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 255, 0, 0, 128);
-        SDL_RenderDrawRect(wdgt->view->app->renderer, &draw_rect);
+        draw_outline(wdgt->view->app->renderer, draw_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 0, 0, 0, 0);
     }
 }
 
 void _show_draw_rect(widget* wdgt) {
     if (wdgt) {
-        SDL_Rect draw_rect;
-        copyRect(&wdgt->rect, &draw_rect);
-        translate_draw_rect(&draw_rect);
+        const SDL_Rect* draw_rect = &wdgt->draw_rect;
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 128, 128, 64, 128);
-        SDL_RenderDrawRect(wdgt->view->app->renderer, &draw_rect);
+        draw_outline(wdgt->view->app->renderer, draw_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 0, 0, 0, 0);
     }
 }
@@ -94,7 +172,7 @@ void _show_input_rect(widget* wdgt) {
         copyRect(&wdgt->input_rect, &input_rect);
         translate_draw_rect(&input_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 128, 0, 0, 128);
-        SDL_RenderDrawRect(wdgt->view->app->renderer, &input_rect);
+        draw_outline(wdgt->view->app->renderer, &input_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 0, 0, 0, 0);
     }
 }
@@ -102,11 +180,9 @@ void _show_input_rect(widget* wdgt) {
 static void button_widget_render(widget* wdgt) {
     DEBUG_RECT(wdgt);
     if (widget_pressed(wdgt)&& !wdgt->hotspot) {
-        SDL_Rect draw_rect;
-        copyRect(&wdgt->rect, &draw_rect);
-        translate_draw_rect(&draw_rect);
+        const SDL_Rect* draw_rect = &wdgt->draw_rect;
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 128, 128, 128, 128);
-        SDL_RenderFillRect(wdgt->view->app->renderer, &draw_rect);
+        draw_fill_rect(wdgt->view->app->renderer, draw_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 0, 0, 0, 0);
     }
     if (widget_highlight(wdgt) && wdgt->hotspot == false && show_rects) {
@@ -116,13 +192,10 @@ static void button_widget_render(widget* wdgt) {
         _show_input_rect(wdgt);
     }
     if (wdgt->hotspot == false || widget_highlight(wdgt))  {
-        SDL_Rect image_rect;
-        copyRect(&wdgt->rect, &image_rect);
-        translate_image_rect(&image_rect);
-        SDL_RenderCopyEx(wdgt->view->app->renderer,
-                tcache_quick_get_texture(wdgt->sub.button.texture_id, wdgt->view->app->renderer),
-                NULL,
-                &image_rect, wdgt->view->app->orientation, NULL, flip);
+        const SDL_Rect* image_rect = &wdgt->image_rect;
+        draw_widget_image(wdgt,
+                tcache_quick_get_texture(wdgt->sub.button.texture_id, wdgt->view->app->renderer, image_rect, NULL),
+                NULL, image_rect);
     }
 }
 
@@ -158,7 +231,7 @@ static void setup_image_fit_src_rect(widget *wdgt) {
                         scale_f,
                         wdgt->sub.image.dst_rect.x, wdgt->sub.image.dst_rect.y, wdgt->sub.image.dst_rect.w, wdgt->sub.image.dst_rect.h
                         );
-                if (wdgt->view->app->orientation == 90.0 || wdgt->view->app->orientation == 270.0) {
+                if (wdgt->view->app->render_orientation == 90.0 || wdgt->view->app->render_orientation == 270.0) {
                     translate_image_rect(&wdgt->sub.image.dst_rect);
                 }
               }break;
@@ -256,11 +329,13 @@ widget* widget_rect(widget *wdgt, const SDL_Rect *rect) {
             wdgt->input_rect.h = wdgt->rect.h/3;
         }
 */
-//        copyRect(&wdgt->rect, &wdgt->image_rect);
-//        translate_image_rect(&wdgt->image_rect);
+        // orientation does not change at runtime,
+        // translate once instead of on every render
+        copyRect(&wdgt->rect, &wdgt->image_rect);
+        translate_image_rect(&wdgt->image_rect);
 
-//        copyRect(&wdgt->rect, &wdgt->draw_rect);
-//        translate_draw_rect(&wdgt->draw_rect);
+        copyRect(&wdgt->rect, &wdgt->draw_rect);
+        translate_draw_rect(&wdgt->draw_rect);
     }
     return wdgt;
 }
@@ -344,7 +419,17 @@ widget* widget_action(widget* wdgt, action action) {
 
 widget* widget_hide(widget* wdgt, bool hide) {
     if (wdgt) {
-        wdgt->hidden = hide;
+        if (wdgt->hidden != hide) {
+            wdgt->hidden = hide;
+            widget_set_dirty(wdgt);
+        }
+    }
+    return wdgt;
+}
+
+widget* widget_static(widget* wdgt, bool yn) {
+    if (wdgt) {
+        wdgt->static_layer = yn;
     }
     return wdgt;
 }
@@ -469,31 +554,28 @@ static void image_widget_render(widget* wdgt) {
         if (show_rects) { _show_draw_rect(wdgt); }
         if (show_input_rects) { _show_input_rect(wdgt); }
     }
-    SDL_Rect image_rect;
-    copyRect(&wdgt->rect, &image_rect);
-    translate_image_rect(&image_rect);
+    const SDL_Rect* image_rect = &wdgt->image_rect;
 
     switch(wdgt->sub.image.scale_op) {
         case IMAGE_STRETCH_FILL:
-            SDL_RenderCopyEx(wdgt->view->app->renderer,
-                   tcache_quick_get_texture(wdgt->sub.image.texture_id, wdgt->view->app->renderer),
-                   NULL, &image_rect,
-                   wdgt->view->app->orientation,
-                   NULL, flip);
+            draw_widget_image(wdgt,
+                   tcache_quick_get_texture(wdgt->sub.image.texture_id, wdgt->view->app->renderer, image_rect, NULL),
+                   NULL, image_rect);
             break;
         case IMAGE_FIT:
-            SDL_RenderCopyEx(wdgt->view->app->renderer,
-                   tcache_quick_get_texture(wdgt->sub.image.texture_id, wdgt->view->app->renderer),
-                   NULL, &wdgt->sub.image.dst_rect,
-                   wdgt->view->app->orientation, NULL, flip);
-            break;
-        case IMAGE_CENTRED_FILL:
-            SDL_RenderCopyEx(wdgt->view->app->renderer,
-                    tcache_quick_get_texture(wdgt->sub.image.texture_id, wdgt->view->app->renderer),
-                    &wdgt->sub.image.src_rect, &image_rect,
-                    wdgt->view->app->orientation,
-                    NULL, flip);
+            draw_widget_image(wdgt,
+                   tcache_quick_get_texture(wdgt->sub.image.texture_id, wdgt->view->app->renderer, &wdgt->sub.image.dst_rect, NULL),
+                   NULL, &wdgt->sub.image.dst_rect);
             break;
+        case IMAGE_CENTRED_FILL: {
+            // the source rect is scaled to match the selected level
+            SDL_Rect src_rect;
+            copyRect(&wdgt->sub.image.src_rect, &src_rect);
+            SDL_Texture* texture = tcache_quick_get_texture(wdgt->sub.image.texture_id, wdgt->view->app->renderer, image_rect, &src_rect);
+            draw_widget_image(wdgt,
+                    texture,
+                    &src_rect, image_rect);
+            }break;
     }
 }
 
@@ -559,11 +641,9 @@ widget* widget_hotspot_edge(widget* wdgt, hotspot_edge edge, SDL_Rect *r) {
 static void multistate_button_widget_render(widget* wdgt) {
     DEBUG_RECT(wdgt);
     if (widget_pressed(wdgt) && !wdgt->hotspot) {
-    SDL_Rect draw_rect;
-        copyRect(&wdgt->rect, &draw_rect);
-        translate_draw_rect(&draw_rect);
+        const SDL_Rect* draw_rect = &wdgt->draw_rect;
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 128, 128, 128, 128);
-        SDL_RenderFillRect(wdgt->view->app->renderer, &draw_rect);
+        draw_fill_rect(wdgt->view->app->renderer, draw_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 0, 0, 0, 0);
     }
     if (widget_highlight(wdgt) && wdgt->hotspot == false && show_rects) {
@@ -573,13 +653,10 @@ static void multistate_button_widget_render(widget* wdgt) {
         _show_input_rect(wdgt);
     }
     if (wdgt->hotspot == false || widget_highlight(wdgt))  {
-        SDL_Rect image_rect;
-        copyRect(&wdgt->rect, &image_rect);
-        translate_image_rect(&image_rect);
-        SDL_RenderCopyEx(wdgt->view->app->renderer,
-            tcache_quick_get_texture(wdgt->sub.multistate_button.res[wdgt->sub.multistate_button.state].texture_id, wdgt->view->app->renderer),
-            NULL, &image_rect,
-            wdgt->view->app->orientation, NULL, flip);
+        const SDL_Rect* image_rect = &wdgt->image_rect;
+        draw_widget_image(wdgt,
+            tcache_quick_get_texture(wdgt->sub.multistate_button.res[wdgt->shown.state].texture_id, wdgt->view->app->renderer, image_rect, NULL),
+            NULL, image_rect);
     }
 }
 
@@ -624,7 +701,12 @@ widget* widget_multistate_button_addstate(widget* wdgt, unsigned statenum, const
 
 widget* widget_multistate_button_set_state(widget* wdgt, unsigned statenum) {
     if (wdgt->type == WIDGET_MULTISTATE_BUTTON && statenum < wdgt->sub.multistate_button.state_count) {
-        wdgt->sub.multistate_button.state = statenum;
+        if (wdgt->sub.multistate_button.state != statenum) {
+            seqlock_write_begin(&wdgt->state_lock);
+            wdgt->sub.multistate_button.state = statenum;
+            seqlock_write_end(&wdgt->state_lock);
+            widget_set_dirty(wdgt);
+        }
     }
     return wdgt;
 }
@@ -713,7 +795,15 @@ static void slider_widget_render(widget* wdgt) {
         if (show_rects) { _show_draw_rect(wdgt); }
         if (show_input_rects) { _show_input_rect(wdgt); }
     }
-    _slider_workspace* wk = slider_widget_init_workspace(wdgt);
+    _slider_workspace* wk = &wdgt->sub.slider.wk;
+    if (!wk->initialised) {
+        seqlock_write_begin(&wdgt->state_lock);
+        slider_widget_init_workspace(wdgt);
+        wdgt->shown.slider.current_pos = wk->current_pos;
+        wdgt->shown.slider.drag_pos = wk->drag_pos;
+        seqlock_write_end(&wdgt->state_lock);
+    }
+    int current_pos = wdgt->shown.slider.current_pos;
 /*    
     if (wk == NULL) {
         return;
@@ -730,12 +820,12 @@ static void slider_widget_render(widget* wdgt) {
     if (wk->value_range_delta > 0) {
         if (wdgt->sub.slider.defined_interactive && wdgt->sub.slider.interactive) {
             if (widget_pressed(wdgt)) {
-                pick_rect.x = wk->drag_pos - wk->half_pw;
+                pick_rect.x = wdgt->shown.slider.drag_pos - wk->half_pw;
             } else {
-                pick_rect.x = wk->current_pos - wk->half_pw;
+                pick_rect.x = current_pos - wk->half_pw;
             }
         } else {
-            pick_rect.x = wk->current_pos - wk->half_pw;
+            pick_rect.x = current_pos - wk->half_pw;
             pick_rect.w = 0;
         }
     }
@@ -743,22 +833,20 @@ static void slider_widget_render(widget* wdgt) {
     {
         _slider_resource* bar_start = wdgt->sub.slider.res[SLIDER_BAR_START].texture_ids[0]? wdgt->sub.slider.res+SLIDER_BAR_START:NULL;
         if (bar_start) {
-            int ix_texture = wk->current_pos > wk->min_pos? 1: 0;
-            SDL_RenderCopyEx(wdgt->view->app->renderer,
-                   tcache_quick_get_texture(bar_start->texture_ids[ix_texture], wdgt->view->app->renderer),
-                   NULL, &wk->bar_start_rect,
-                   wdgt->view->app->orientation, NULL, flip);
+            int ix_texture = current_pos > wk->min_pos? 1: 0;
+            draw_widget_image(wdgt,
+                   tcache_quick_get_texture(bar_start->texture_ids[ix_texture], wdgt->view->app->renderer, &wk->bar_start_rect, NULL),
+                   NULL, &wk->bar_start_rect);
         }
     }
 
     {
         _slider_resource* bar_end = wdgt->sub.slider.res[SLIDER_BAR_END].texture_ids[0]? wdgt->sub.slider.res+SLIDER_BAR_END:NULL;
         if (bar_end) {
-            int ix_texture = wk->current_pos < wk->max_pos? 0: 1;
-            SDL_RenderCopyEx(wdgt->view->app->renderer,
-                   tcache_quick_get_texture(bar_end->texture_ids[ix_texture], wdgt->view->app->renderer),
-                   NULL, &wk->bar_end_rect,
-                   wdgt->view->app->orientation, NULL, flip);
+            int ix_texture = current_pos < wk->max_pos? 0: 1;
+            draw_widget_image(wdgt,
+                   tcache_quick_get_texture(bar_end->texture_ids[ix_texture], wdgt->view->app->renderer, &wk->bar_end_rect, NULL),
+                   NULL, &wk->bar_end_rect);
         }
     }
 
@@ -768,20 +856,18 @@ static void slider_widget_render(widget* wdgt) {
         copyRect(&wk->bar_rect, &image_rect);
         image_rect.w = pick_rect.x - image_rect.x;
         translate_image_rect(&image_rect);
-        SDL_RenderCopyEx(wdgt->view->app->renderer,
-                tcache_quick_get_texture(bar->texture_ids[0], wdgt->view->app->renderer),
-                NULL, &image_rect,
-                wdgt->view->app->orientation, NULL, flip);
+        draw_widget_image(wdgt,
+                tcache_quick_get_texture(bar->texture_ids[0], wdgt->view->app->renderer, &image_rect, NULL),
+                NULL, &image_rect);
     }
 
     if (pick_rect.w && pick_rect.h && wdgt->sub.slider.defined_interactive && wdgt->sub.slider.interactive) {
         SDL_Rect image_rect;
         copyRect(&pick_rect, &image_rect);
         translate_image_rect(&image_rect);
-        SDL_RenderCopyEx(wdgt->view->app->renderer,
-                tcache_quick_get_texture(pick->texture_ids[0], wdgt->view->app->renderer),
-                NULL, &image_rect,
-                wdgt->view->app->orientation, NULL, flip);
+        draw_widget_image(wdgt,
+                tcache_quick_get_texture(pick->texture_ids[0], wdgt->view->app->renderer, &image_rect, NULL),
+                NULL, &image_rect);
     }
 
     if (bar) {
@@ -790,10 +876,9 @@ static void slider_widget_render(widget* wdgt) {
         image_rect.w -= pick_rect.x + pick_rect.w - image_rect.x;
         image_rect.x = pick_rect.x + pick_rect.w;
         translate_image_rect(&image_rect);
-        SDL_RenderCopyEx(wdgt->view->app->renderer,
-                tcache_quick_get_texture(bar->texture_ids[1], wdgt->view->app->renderer),
-                NULL, &image_rect,
-                wdgt->view->app->orientation, NULL, flip);
+        draw_widget_image(wdgt,
+                tcache_quick_get_texture(bar->texture_ids[1], wdgt->view->app->renderer, &image_rect, NULL),
+                NULL, &image_rect);
     }
 
 }
@@ -889,6 +974,7 @@ static widget *widget_slider_track(widget* wdgt, const SDL_Point *pt) {
             _slider_resource* pick = wdgt->sub.slider.res+SLIDER_PICK;
             _slider_workspace* wk = &wdgt->sub.slider.wk;
             if (pick) {
+                seqlock_write_begin(&wdgt->state_lock);
                 if (pt->x < wk->min_pos) {
                     wk->drag_pos = wk->min_pos;
                 } else if (pt->x > wk->max_pos) {
@@ -896,6 +982,8 @@ static widget *widget_slider_track(widget* wdgt, const SDL_Point *pt) {
                 } else {
                     wk->drag_pos = pt->x;
                 }
+                seqlock_write_end(&wdgt->state_lock);
+                widget_set_dirty(wdgt);
             }
         }
     }
@@ -906,7 +994,10 @@ static widget *widget_slider_tracking_commit(widget* wdgt, const SDL_Point *pt)
     if (wdgt->sub.slider.defined_interactive && wdgt->sub.slider.interactive) {
         widget_slider_track(wdgt, pt);
         _slider_workspace* wk = &wdgt->sub.slider.wk;
+        seqlock_write_begin(&wdgt->state_lock);
         wk->current_pos = wk->drag_pos;
+        seqlock_write_end(&wdgt->state_lock);
+        widget_set_dirty(wdgt);
     }
     return wdgt;
 }
@@ -915,17 +1006,22 @@ static widget *widget_slider_tracking_commit(widget* wdgt, const SDL_Point *pt)
 widget *widget_slider_set_value(widget* wdgt, int value) {
     if (wdgt && wdgt->type == WIDGET_SLIDER) {
         if (value >= wdgt->sub.slider.range.start && value <= wdgt->sub.slider.range.end) {
+            seqlock_write_begin(&wdgt->state_lock);
             _slider_workspace* wk = slider_widget_init_workspace(wdgt);
             if (wk->value_range_delta) {
                 // range must be non-zero to calculate the position of the pick
                 float offset = ((float)(value - wdgt->sub.slider.range.start)*(wk->max_pos - wk->min_pos))/wk->value_range_delta;
                 wk->current_pos = wk->min_pos + (int)offset;
+            }
+            seqlock_write_end(&wdgt->state_lock);
+            if (wk->value_range_delta) {
                 dummy_printf("widget_slider_set_value (%d * %d)/%d = %d, for %d\n", 
                         value - wdgt->sub.slider.range.start,
                         (wk->max_pos - wk->min_pos),
                         wk->value_range_delta,
                         wk->current_pos,
                         value);
+                widget_set_dirty(wdgt);
             }
         } else {
             error_printf("widget_slider_set_value: %d not in range %d-%d\n",
@@ -969,7 +1065,13 @@ widget *widget_slider_define_interactive(widget* wdgt, bool yn) {
 widget *widget_slider_get_value(widget* wdgt, int* value) {
     if (wdgt && wdgt->type == WIDGET_SLIDER) {
         _slider_workspace* wk = &wdgt->sub.slider.wk;
-        int v = (wk->current_pos - wk->min_pos);
+        uint32_t seq;
+        int v;
+        do {
+            while (!seqlock_read_try(&wdgt->state_lock, &seq)) {
+            }
+            v = (wk->current_pos - wk->min_pos);
+        } while (seqlock_read_retry(&wdgt->state_lock, seq));
         dummy_printf("widget_slider_get_value v=%d\n", v);
         v *= wk->value_range_delta;
         v /= (wk->max_pos - wk->min_pos);
@@ -982,11 +1084,9 @@ static void text_widget_render(widget* wdgt) {
     DEBUG_RECT(wdgt);
     _text_data_ptr txt_w = &wdgt->sub.text;
     if (widget_pressed(wdgt)&& !wdgt->hotspot) {
-        SDL_Rect draw_rect;
-        copyRect(&wdgt->rect, &draw_rect);
-        translate_draw_rect(&draw_rect);
+        const SDL_Rect* draw_rect = &wdgt->draw_rect;
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 128, 128, 128, 128);
-        SDL_RenderFillRect(wdgt->view->app->renderer, &draw_rect);
+        draw_fill_rect(wdgt->view->app->renderer, draw_rect);
         SDL_SetRenderDrawColor(wdgt->view->app->renderer, 0, 0, 0, 0);
     }
     if (widget_highlight(wdgt) && wdgt->hotspot == false && show_rects) {
@@ -997,12 +1097,16 @@ static void text_widget_render(widget* wdgt) {
     }
     if (wdgt->hotspot == false || widget_highlight(wdgt))  {
         SDL_Rect image_rect;
-        copyRect(&txt_w->dst_rect, &image_rect);
+        SDL_Texture* texture = tcache_quick_get_texture(txt_w->texture_id, wdgt->view->app->renderer, NULL, NULL);
+        if (seqlock_read_retry(&wdgt->state_lock, wdgt->shown_seq)) {
+            // the text changed after the state was taken, the texture
+            // may be the new text, take its placement as well
+            widget_take_state(wdgt);
+            texture = tcache_quick_get_texture(txt_w->texture_id, wdgt->view->app->renderer, NULL, NULL);
+        }
+        copyRect(&wdgt->shown.text_rect, &image_rect);
         translate_image_rect(&image_rect);
-        SDL_RenderCopyEx(wdgt->view->app->renderer,
-                tcache_quick_get_texture(txt_w->texture_id, wdgt->view->app->renderer),
-                NULL,
-                &image_rect, wdgt->view->app->orientation, NULL, flip);
+        draw_widget_image(wdgt, texture, NULL, &image_rect);
     }
 }
 
@@ -1065,13 +1169,13 @@ static void text_render_surface(widget* wdgt) {
                         surface = scaled_surface;
                     }
                 }
-                tcache_set_surface(txt_w->texture_id, surface);
+                SDL_Rect dst_rect;
                 txt_w->content_dim.w = surface->w;
                 txt_w->content_dim.h = surface->h;
-                txt_w->dst_rect.x = wdgt->rect.x + ((wdgt->rect.w - surface->w)/2);
-                txt_w->dst_rect.y = wdgt->rect.y + ((wdgt->rect.h - surface->h)/2);
-                txt_w->dst_rect.w = surface->w;
-                txt_w->dst_rect.h = surface->h;
+                dst_rect.x = wdgt->rect.x + ((wdgt->rect.w - surface->w)/2);
+                dst_rect.y = wdgt->rect.y + ((wdgt->rect.h - surface->h)/2);
+                dst_rect.w = surface->w;
+                dst_rect.h = surface->h;
                 
                 // for now scale text to fit content.
                 float scale_x = (float)surface->w/wdgt->rect.w;
@@ -1086,13 +1190,20 @@ static void text_render_surface(widget* wdgt) {
                             scaled_w, scaled_h,
                             txt_w->content
                             );
-                    txt_w->dst_rect.x = wdgt->rect.x + ((wdgt->rect.w - scaled_w)/2);
-                    txt_w->dst_rect.y = wdgt->rect.y + ((wdgt->rect.h - scaled_h)/2);
-                    txt_w->dst_rect.w = scaled_w;
-                    txt_w->dst_rect.h = scaled_h;
+                    dst_rect.x = wdgt->rect.x + ((wdgt->rect.w - scaled_w)/2);
+                    dst_rect.y = wdgt->rect.y + ((wdgt->rect.h - scaled_h)/2);
+                    dst_rect.w = scaled_w;
+                    dst_rect.h = scaled_h;
                 }
+                // the text and its placement are published together,
+                // the render thread never takes one without the other
+                seqlock_write_begin(&wdgt->state_lock);
+                tcache_set_surface(txt_w->texture_id, surface);
+                copyRect(&dst_rect, &txt_w->dst_rect);
+                seqlock_write_end(&wdgt->state_lock);
             }
         }
+        widget_set_dirty(wdgt);
     }
 }
 
@@ -1189,10 +1300,66 @@ widget_list* destroy_widget_list(widget_list* list) {
     return NULL;
 }
 
+static void widget_set_loaded(widget* wdgt) {
+    __atomic_store_n(&wdgt->atomic_loaded, true, __ATOMIC_RELEASE);
+    widget_set_dirty(wdgt);
+}
+
+static inline bool widget_loaded(widget* wdgt) {
+    return __atomic_load_n(&wdgt->atomic_loaded, __ATOMIC_ACQUIRE);
+}
+
 void widget_list_load_media(const widget_list* list, const char* resource_path) {
     for (widget* widget = list->head.next; widget != NULL; widget = widget->next) {
         widget_load_media(widget, resource_path);
+        widget_set_loaded(widget);
+    }
+}
+
+typedef struct {
+    widget_list* list;
+    const char*  resource_path;
+    // SDL_ttf is not thread safe, text widgets are loaded on one thread
+    bool         text;
+} media_loader;
+
+static int media_loader_thread(void* data) {
+    const media_loader* loader = data;
+    int64_t t0 = get_micro_seconds();
+    for (widget* widget = loader->list->head.next; widget != &loader->list->tail; widget = widget->next) {
+        if ((widget->type == WIDGET_TEXT) == loader->text) {
+            widget_load_media(widget, loader->resource_path);
+            if (widget->type == WIDGET_VUMETER) {
+                widget_vumeter_select_by_name(widget, widget->view->app->first_vu_meter);
+            }
+            widget_set_loaded(widget);
+        }
     }
+    perf_printf("media loader %s: %ld milliseconds\n", loader->text ? "text" : "images", (get_micro_seconds() - t0)/1000);
+    __atomic_sub_fetch(&loader->list->atomic_loading, 1, __ATOMIC_ACQ_REL);
+    tcache_thread_exit();
+    return 0;
+}
+
+void widget_list_load_media_async(widget_list* list, const char* resource_path) {
+    static media_loader loaders[2];
+    __atomic_store_n(&list->atomic_loading, 2, __ATOMIC_RELEASE);
+    for (int ix = 0; ix < 2; ++ix) {
+        loaders[ix].list = list;
+        loaders[ix].resource_path = resource_path;
+        loaders[ix].text = ix == 1;
+        SDL_Thread* thread = SDL_CreateThread(media_loader_thread, loaders[ix].text ? "load-text" : "load-images", loaders + ix);
+        if (thread) {
+            SDL_DetachThread(thread);
+        } else {
+            error_printf("widget_list_load_media_async: %s, loading synchronously\n", SDL_GetError());
+            media_loader_thread(loaders + ix);
+        }
+    }
+}
+
+bool widget_list_media_loaded(const widget_list* list) {
+    return __atomic_load_n(&list->atomic_loading, __ATOMIC_ACQUIRE) == 0;
 }
 
 void widget_list_react(const widget_list* list, const pointer_input input, SDL_Point* pt) {
@@ -1264,3 +1431,320 @@ void widget_list_react(const widget_list* list, const pointer_input input, SDL_P
     }
 }
 
+
+void widget_list_invalidate(const widget_list* list) {
+    for (widget* widget = list->head.next; widget != &list->tail; widget = widget->next) {
+        widget_set_dirty(widget);
+    }
+}
+
+// screen region covered by the widget, including the input rectangle
+// when that may be drawn
+static bool widget_damage_rect(widget* wdgt, SDL_Rect* rect) {
+    SDL_Rect screen = {0, 0, wdgt->view->app->render_width, wdgt->view->app->render_height};
+    SDL_Rect r;
+    copyRect(&wdgt->draw_rect, rect);
+    if (show_input_rects) {
+        copyRect(&wdgt->input_rect, &r);
+        translate_draw_rect(&r);
+        SDL_UnionRect(rect, &r, rect);
+    }
+    return SDL_IntersectRect(rect, &screen, rect);
+}
+
+static void damage_add(widget_damage* damage, const SDL_Rect* rect) {
+    // merge with an overlapping region, the overlap would be drawn twice
+    for (int ix = 0; ix < damage->count; ++ix) {
+        if (SDL_HasIntersection(damage->rects + ix, rect)) {
+            SDL_UnionRect(damage->rects + ix, rect, damage->rects + ix);
+            return;
+        }
+    }
+    if (damage->count < WIDGET_DAMAGE_RECTS_MAX) {
+        copyRect(rect, damage->rects + damage->count);
+        ++damage->count;
+        return;
+    }
+    // out of slots, fold everything into a single region
+    for (int ix = 1; ix < damage->count; ++ix) {
+        SDL_UnionRect(damage->rects, damage->rects + ix, damage->rects);
+    }
+    SDL_UnionRect(damage->rects, rect, damage->rects);
+    damage->count = 1;
+}
+
+// Collect and clear the redraw marks of the widgets in the list.
+// Hidden widgets are included, the region they covered must be redrawn.
+// Animated widgets are included if animate is set.
+void widget_list_collect_damage(const widget_list* list, widget_damage* damage, bool animate) {
+    damage->count = 0;
+    for (widget* widget = list->head.next; widget != &list->tail; widget = widget->next) {
+        SDL_Rect rect;
+        bool dirty = widget_take_dirty(widget);
+        if (dirty) {
+            widget_take_state(widget);
+        }
+        if ((dirty || (animate && widget->animated && !widget->hidden)) && widget_damage_rect(widget, &rect)) {
+            damage_add(damage, &rect);
+        }
+    }
+}
+
+// Render the widget and account the render calls to it, a widget
+// drawn in several damage regions accumulates the cost for the frame.
+static void widget_render_counted(widget* wdgt) {
+    draw_stats start = draw_counters;
+    draw_stats cost;
+    wdgt->render(wdgt);
+    draw_stats_since(&start, &cost);
+    if (wdgt->draw_frame != draw_stats_frame()) {
+        wdgt->draw_frame = draw_stats_frame();
+        memset(&wdgt->draw_cost, 0, sizeof(wdgt->draw_cost));
+    }
+    draw_stats_add(&wdgt->draw_cost, &cost);
+}
+
+static void widget_layer_bake(widget_layer* layer) {
+    SDL_Renderer* renderer = layer->first->view->app->renderer;
+    SDL_Texture* target = SDL_GetRenderTarget(renderer);
+    SDL_Rect clip;
+    bool clipped = SDL_RenderIsClipEnabled(renderer);
+    SDL_RenderGetClipRect(renderer, &clip);
+
+    // changing the render target resets the clip rectangle
+    SDL_SetRenderTarget(renderer, layer->texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, layer->opaque ? 255 : 0);
+    draw_clear(renderer);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_Rect screen = {0, 0, layer->first->view->app->render_width, layer->first->view->app->render_height};
+    SDL_Rect rect;
+    // the bottom layer stands in for clearing the screen
+    layer->bounds = layer->opaque ? screen : (SDL_Rect){0, 0, 0, 0};
+    for (widget* widget = layer->first; widget != layer->last->next; widget = widget->next) {
+        if (!widget->hidden && widget_loaded(widget)) {
+            widget_render_counted(widget);
+            if (widget_damage_rect(widget, &rect)) {
+                SDL_UnionRect(&layer->bounds, &rect, &layer->bounds);
+            }
+        }
+    }
+    SDL_SetRenderTarget(renderer, target);
+    SDL_RenderSetClipRect(renderer, clipped ? &clip : NULL);
+}
+
+static void widget_layer_render(widget_layer* layer, const SDL_Rect* rect) {
+    draw_copy(layer->first->view->app->renderer, layer->texture, rect, rect);
+}
+
+// The part of region drawn by the layer, baking the layer if it is stale,
+// NULL region => all of the layer.
+static bool widget_layer_area(widget_layer* layer, const SDL_Rect* region, SDL_Rect* rect) {
+    if (__atomic_exchange_n(&layer->atomic_stale, false, __ATOMIC_ACQ_REL)) {
+        widget_layer_bake(layer);
+    }
+    if (region) {
+        return SDL_IntersectRect(&layer->bounds, region, rect);
+    }
+    copyRect(&layer->bounds, rect);
+    return !SDL_RectEmpty(rect);
+}
+
+// occluders considered per region, the ones drawn first are kept
+#define WIDGET_OCCLUDERS_MAX 16
+
+typedef struct {
+    // position in the list, an occluder only hides widgets before it
+    int      seq;
+    SDL_Rect rect;
+} widget_occluder;
+
+// Screen area the widget paints with fully opaque pixels.
+static bool widget_opaque_rect(widget* wdgt, SDL_Rect* rect) {
+    if (wdgt->hidden || wdgt->hotspot || !widget_loaded(wdgt)) {
+        return false;
+    }
+    switch (wdgt->type) {
+        case WIDGET_IMAGE:
+            if (wdgt->sub.image.scale_op != IMAGE_FIT && tcache_quick_get_texture_opaque(wdgt->sub.image.texture_id)) {
+                copyRect(&wdgt->draw_rect, rect);
+                return true;
+            }
+            return false;
+        case WIDGET_VUMETER:
+            return widget_vumeter_opaque_rect(wdgt, rect);
+        default:
+            return false;
+    }
+}
+
+static inline bool rect_contains(const SDL_Rect* outer, const SDL_Rect* inner) {
+    return outer->x <= inner->x && outer->y <= inner->y
+        && outer->x + outer->w >= inner->x + inner->w
+        && outer->y + outer->h >= inner->y + inner->h;
+}
+
+// whether rect is completely painted over by a widget after seq
+static bool occluded(const widget_occluder* occluders, int count, int seq, const SDL_Rect* rect) {
+    for (int ix = 0; ix < count; ++ix) {
+        if (occluders[ix].seq > seq && rect_contains(&occluders[ix].rect, rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Render the visible widgets that intersect region, or all if region is NULL.
+// A layer stands in for the static widgets in it. Widgets and layers
+// completely covered by an opaque widget drawn after them are skipped,
+// if clear is set the region is cleared unless it is covered.
+static void widget_list_render_region(const widget_list* list, const SDL_Rect* region, bool clear) {
+    SDL_Rect screen = {0, 0, list->head.view->app->render_width, list->head.view->app->render_height};
+    const SDL_Rect* area = region ? region : &screen;
+    widget_occluder occluders[WIDGET_OCCLUDERS_MAX];
+    int count = 0;
+    int seq = 0;
+    for (widget* widget = list->head.next; widget != &list->tail && count < WIDGET_OCCLUDERS_MAX; widget = widget->next, ++seq) {
+        SDL_Rect rect;
+        if (widget_opaque_rect(widget, &rect) && SDL_IntersectRect(&rect, area, &occluders[count].rect)) {
+            occluders[count].seq = seq;
+            ++count;
+        }
+    }
+
+    if (clear && !occluded(occluders, count, -1, area)) {
+        SDL_Renderer* renderer = list->head.view->app->renderer;
+        SDL_BlendMode blend_mode;
+        SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+        // SDL_RenderClear ignores the clip rectangle
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        draw_fill_rect(renderer, area);
+        SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+    }
+
+    seq = 0;
+    for (widget* widget = list->head.next; widget != &list->tail; widget = widget->next, ++seq) {
+        SDL_Rect rect;
+        if (widget->layer) {
+            widget_layer* layer = widget->layer;
+            for (; widget != layer->last; widget = widget->next) {
+                ++seq;
+            }
+            if (widget_layer_area(layer, region, &rect) && !occluded(occluders, count, seq, &rect)) {
+                widget_layer_render(layer, &rect);
+            }
+        } else if (!widget->hidden && widget_loaded(widget)) {
+            if (widget_damage_rect(widget, &rect) && SDL_IntersectRect(&rect, area, &rect)
+                    && !occluded(occluders, count, seq, &rect)) {
+                widget_render_counted(widget);
+            }
+        }
+    }
+}
+
+void widget_list_render(const widget_list* list) {
+    widget_list_render_region(list, NULL, false);
+}
+
+// Redraw the damaged regions of the current render target,
+// only widgets which intersect a region are drawn, clipped to that region.
+void widget_list_render_damage(const widget_list* list, const widget_damage* damage) {
+    SDL_Renderer* renderer = list->head.view->app->renderer;
+    for (int ix = 0; ix < damage->count; ++ix) {
+        const SDL_Rect* region = damage->rects + ix;
+        SDL_RenderSetClipRect(renderer, region);
+        widget_list_render_region(list, region, true);
+    }
+    SDL_RenderSetClipRect(renderer, NULL);
+}
+
+void widget_list_report_draw_stats(const widget_list* list, void (*printer)(char *format, ...)) {
+    for (widget* widget = list->head.next; widget != &list->tail; widget = widget->next) {
+        if (widget->draw_frame != 0) {
+            const draw_stats* cost = &widget->draw_cost;
+            printer("    %-8s %4d,%-4d %4dx%-4d %s draws=%u copies=%u rotated=%u scaled=%u textures=%u src_px=%lu dst_px=%lu\n",
+                    widget_type_name(widget->type),
+                    widget->rect.x, widget->rect.y, widget->rect.w, widget->rect.h,
+                    widget->layer ? "layer" : "     ",
+                    cost->draw_calls, cost->copies, cost->rotated, cost->scaled, cost->textures,
+                    cost->src_pixels, cost->dst_pixels);
+        }
+    }
+}
+
+static widget_layer* widget_layer_create(widget* first, widget* last, bool opaque) {
+    const app_context* app = first->view->app;
+    widget_layer* layer = calloc(1, sizeof(widget_layer));
+    if (layer == NULL) {
+        return NULL;
+    }
+    layer->texture = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+            app->render_width, app->render_height);
+    if (layer->texture == NULL) {
+        error_printf("widget_layer_create: failed to create layer texture %s\n", SDL_GetError());
+        free(layer);
+        return NULL;
+    }
+    layer->num_bytes = 4 * app->render_width * app->render_height;
+    tcache_add_external_bytes(layer->num_bytes);
+    if (opaque) {
+        SDL_SetTextureBlendMode(layer->texture, SDL_BLENDMODE_NONE);
+    } else {
+        // layer colours are already multiplied by alpha
+        SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+                SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+                SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+        if (SDL_SetTextureBlendMode(layer->texture, premultiplied)) {
+            // not supported by the renderer, translucent edges are slightly darker
+            SDL_SetTextureBlendMode(layer->texture, SDL_BLENDMODE_BLEND);
+        }
+    }
+    layer->first = first;
+    layer->last = last;
+    layer->opaque = opaque;
+    layer->atomic_stale = true;
+    for (widget* widget = first; widget != last->next; widget = widget->next) {
+        __atomic_store_n(&widget->layer, layer, __ATOMIC_RELEASE);
+    }
+    return layer;
+}
+
+// Group runs of consecutive static widgets into layers, render thread.
+// Media may still be loading, a layer starts stale and is baked again
+// when a widget in it finishes loading and is marked dirty.
+void widget_list_create_layers(widget_list* list) {
+    if (!SDL_RenderTargetSupported(list->head.view->app->renderer)) {
+        return;
+    }
+    widget_layer** tail = &list->layers;
+    widget* widget = list->head.next;
+    while (widget != &list->tail) {
+        if (!widget->static_layer) {
+            widget = widget->next;
+            continue;
+        }
+        struct widget* last = widget;
+        while (last->next != &list->tail && last->next->static_layer) {
+            last = last->next;
+        }
+        widget_layer* layer = widget_layer_create(widget, last, widget == list->head.next);
+        if (layer) {
+            *tail = layer;
+            tail = &layer->next;
+            dummy_printf("widget layer %p %s..%s\n", layer, widget_type_name(widget->type), widget_type_name(last->type));
+        }
+        widget = last->next;
+    }
+}
+
+void widget_list_destroy_layers(widget_list* list) {
+    while (list->layers) {
+        widget_layer* layer = list->layers;
+        list->layers = layer->next;
+        for (widget* widget = layer->first; widget != layer->last->next; widget = widget->next) {
+            widget->layer = NULL;
+        }
+        SDL_DestroyTexture(layer->texture);
+        tcache_add_external_bytes(-layer->num_bytes);
+        free(layer);
+    }
+}
@@ -7,6 +7,8 @@
 #include "actions.h"
 #include "types.h"
 #include "texture_cache.h"
+#include "draw_stats.h"
+#include "seqlock.h"
 
 #define  WH_FILL (-1)
 
@@ -56,6 +58,7 @@ typedef struct spmeter_widget spmeter_widget;
 
 typedef struct widget widget;
 typedef struct widget_list widget_list;
+typedef struct widget_layer widget_layer;
 typedef struct view_context view_context;
 
 typedef struct _btn_resource {
@@ -104,6 +107,18 @@ typedef struct {
     SDL_Rect dst_rect;
 }_text_data,*_text_data_ptr;
 
+// State changed by the player and input threads while the render thread
+// draws. Writers update the fields in sub under state_lock, the render
+// thread copies them to shown when it collects the widget for a frame.
+typedef union {
+    struct {
+        int current_pos;
+        int drag_pos;
+    } slider;
+    SDL_Rect text_rect;
+    unsigned state;
+} widget_state;
+
 struct widget {
     struct      widget *next;
     struct      widget *prev;
@@ -116,7 +131,14 @@ struct widget {
     bool        focussed;
     // 
     bool        atomic_highlight;
+    // set when the widget needs to be redrawn
+    bool        atomic_dirty;
+    // animated widgets are redrawn every frame
+    bool        animated;
     bool        hidden;
+    // static widgets are rendered into a cached layer
+    bool        static_layer;
+    widget_layer* layer;
     bool        hotspot;
     const bool  focus_disabled;
     // generic image path for all widgets with single images
@@ -126,12 +148,22 @@ struct widget {
     SDL_Rect    rect;
     SDL_Rect    input_rect;
     // For now 2 translated rectangles are used to handle 
-    // orientation correctly. 
+    // orientation correctly, both are set with rect by widget_rect.
     // TODO further investigation.
     // 1 - for rotated images
-    // SDL_Rect    image_rect;
+    SDL_Rect    image_rect;
     // 2 - for unrotated operations like DrawRect, FillRect
-    //SDL_Rect    draw_rect;
+    SDL_Rect    draw_rect;
+    // set once the media of the widget is loaded, not drawn before
+    bool        atomic_loaded;
+    // guards the fields of sub published in shown, see widget_state
+    seqlock     state_lock;
+    // render thread copy of the published state, and its sequence
+    widget_state shown;
+    uint32_t    shown_seq;
+    // render calls made by the widget in the frame draw_frame
+    draw_stats  draw_cost;
+    uint32_t    draw_frame;
 
     bool         atomic_pressed;
     const char*  player_value_key;
@@ -177,6 +209,7 @@ bool widget_highlight(widget* wdgt);
 void widget_set_highlight(widget* wdgt, bool onoff);
 bool widget_pressed(widget* wdgt);
 void widget_set_pressed(widget* wdgt, bool onoff);
+void widget_set_dirty(widget* wdgt);
 
 
 extern bool debug_rects;
@@ -201,6 +234,7 @@ widget* widget_load_media(widget* wdgt, const char* resource_path);
 widget* widget_destroy(widget* wdgt);
 widget* widget_action(widget* wdgt, action action);
 widget* widget_hide(widget* wdgt, bool hide);
+widget* widget_static(widget* wdgt, bool yn);
 widget* widget_hotspot(widget* wdgt, bool hotspot);
 widget* widget_hotspot_edge(widget* wdgt, hotspot_edge edge, SDL_Rect *r);
 widget* widget_image_path(widget* wdgt, const char* path);
@@ -220,6 +254,11 @@ widget *widget_vumeter_select_next(widget *wdgt);
 widget *widget_vumeter_select_prev(widget *wdgt);
 widget *widget_vumeter_select_by_name(widget *wdgt, const char* name);
 widget *widget_vumeter_select_lock(widget *wdgt, bool lock);
+widget *widget_vumeter_select_index(widget *wdgt, int indx);
+int widget_vumeter_count(widget *wdgt);
+const char* widget_vumeter_name(widget *wdgt);
+// screen area fully painted by the selected meter, false if unknown
+bool widget_vumeter_opaque_rect(widget *wdgt, SDL_Rect* rect);
 
 widget *widget_create_slider(const view_context*);
 widget *widget_slider_range(widget* , int start, int end);
@@ -240,6 +279,9 @@ widget* widget_text_set_colour(widget*, SDL_Color colour);
 struct widget_list {
     widget head;
     widget tail;
+    widget_layer* layers;
+    // media loader threads still running
+    int           atomic_loading;
 };
 
 struct view_context {
@@ -251,7 +293,26 @@ widget_list* create_widget_list(view_context* view);
 widget_list* destroy_widget_list(widget_list*);
 widget_list* destroy_widgets_in_list(widget_list*);
 
+// damaged screen regions, in renderer (logical) coordinates
+#define WIDGET_DAMAGE_RECTS_MAX 8
+typedef struct {
+    int      count;
+    SDL_Rect rects[WIDGET_DAMAGE_RECTS_MAX];
+} widget_damage;
+
 void widget_dispatch_action(widget* wdgt);
 void widget_list_load_media(const widget_list* list, const char* resource_path);
+// Load the media on background threads and return, widgets are drawn
+// as their media is loaded. The VU meters select app first_vu_meter.
+void widget_list_load_media_async(widget_list* list, const char* resource_path);
+bool widget_list_media_loaded(const widget_list* list);
 void widget_list_react(const widget_list* list, const pointer_input input, SDL_Point* pt);
+void widget_list_invalidate(const widget_list* list);
+void widget_list_create_layers(widget_list* list);
+void widget_list_destroy_layers(widget_list* list);
+void widget_list_render(const widget_list* list);
+void widget_list_collect_damage(const widget_list* list, widget_damage* damage, bool animate);
+void widget_list_render_damage(const widget_list* list, const widget_damage* damage);
+// the render calls of each widget when it was last drawn
+void widget_list_report_draw_stats(const widget_list* list, void (*printer)(char *format, ...));
 #endif // __jl_widgets_h_
@@ -62,6 +62,7 @@ typedef enum {
     JT_HOTSPOT_EDGE,
     JT_FOCUS_ENABLE,
     JT_HIDDEN,
+    JT_STATIC,
 
     JT_SELECT,
 
@@ -123,6 +124,7 @@ static const char* json_token_strings[]= {
     "hotspot_edge",
     "focus_enable",
     "hidden",
+    "static",
 
     "select",
 
@@ -628,6 +630,8 @@ static void deserialise_one_widget(json_value* value, view_context* ctx) {
 
         widget_hide(widget, get_object_boolean_value(value, JT_HIDDEN, false));
         json_printf("     hidden: %d\n", widget->hidden);
+        widget_static(widget, get_object_boolean_value(value, JT_STATIC, false));
+        json_printf("     static: %d\n", widget->static_layer);
         widget_hotspot(widget, get_object_boolean_value(value, JT_HOTSPOT, false));
         widget_hotspot_edge(widget, tokenise_hotspot_edge(get_object_string_value(value, JT_HOTSPOT_EDGE, NULL)), &container);
         json_printf("     hotspot: %d edge=%d, %s\n",